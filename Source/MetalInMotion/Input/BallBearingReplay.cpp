@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingReplay.h"
+
+#include "EngineUtils.h"
+#include "MetalInMotion/Public/BallBearing.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+void FBallBearingReplay::CaptureInitialStates(UWorld* world)
+{
+	InitialStates.Reset();
+
+	for (TActorIterator<ABallBearing> it(world); it; ++it)
+	{
+		const ABallBearing* ballBearing = *it;
+
+		FBallBearingReplayBearingState& state = InitialStates.AddDefaulted_GetRef();
+		state.Name = ballBearing->GetFName();
+		state.Transform = ballBearing->GetActorTransform();
+		state.LinearVelocity = ballBearing->BallMesh->GetPhysicsLinearVelocity();
+		state.AngularVelocityInDeg = ballBearing->BallMesh->GetPhysicsAngularVelocityInDegrees();
+	}
+}
+
+void FBallBearingReplay::ApplyInitialStates(UWorld* world) const
+{
+	TMap<FName, const FBallBearingReplayBearingState*> statesByName;
+	for (const FBallBearingReplayBearingState& state : InitialStates)
+	{
+		statesByName.Add(state.Name, &state);
+	}
+
+	for (TActorIterator<ABallBearing> it(world); it; ++it)
+	{
+		ABallBearing* ballBearing = *it;
+
+		const FBallBearingReplayBearingState* const* state = statesByName.Find(ballBearing->GetFName());
+		if (!state)continue;
+
+		ballBearing->SetActorTransform((*state)->Transform, false, nullptr, ETeleportType::ResetPhysics);
+		ballBearing->BallMesh->SetPhysicsLinearVelocity((*state)->LinearVelocity);
+		ballBearing->BallMesh->SetPhysicsAngularVelocityInDegrees((*state)->AngularVelocityInDeg);
+	}
+}
+
+bool FBallBearingReplay::SaveToFile(const FString& fileName)
+{
+	TArray<uint8> bytes;
+	FMemoryWriter writer(bytes);
+
+	uint32 magic = FileMagic;
+	uint32 version = FileVersion;
+	writer << magic << version;
+	writer << InitialStates;
+	writer << Frames;
+
+	return FFileHelper::SaveArrayToFile(bytes, *fileName);
+}
+
+bool FBallBearingReplay::LoadFromFile(const FString& fileName)
+{
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *fileName))return false;
+
+	FMemoryReader reader(bytes);
+
+	uint32 magic = 0;
+	uint32 version = 0;
+	reader << magic << version;
+	if (magic != FileMagic || version != FileVersion)return false;
+
+	reader << InitialStates;
+	reader << Frames;
+
+	return !reader.IsError();
+}
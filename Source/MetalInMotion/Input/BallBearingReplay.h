@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ABallBearing;
+
+// Input of a single game frame
+struct FBallBearingReplayFrame
+{
+	enum EInputFlags : uint8
+	{
+		Move = 1 << 0,
+		Jump = 1 << 1,
+		Dash = 1 << 2
+	};
+
+	float DeltaSeconds = 0.0f;
+
+	// Valid if Flags has Move
+	FVector MoveInput = FVector::ZeroVector;
+
+	uint8 Flags = 0;
+
+	friend FArchive& operator<<(FArchive& archive, FBallBearingReplayFrame& frame)
+	{
+		archive << frame.DeltaSeconds << frame.Flags;
+
+		if (frame.Flags & Move)
+		{
+			archive << frame.MoveInput;
+		}
+
+		return archive;
+	}
+};
+
+// Physics state of a ball bearing when the recording started, matched by actor name on playback
+struct FBallBearingReplayBearingState
+{
+	FName Name;
+	FTransform Transform;
+	FVector LinearVelocity = FVector::ZeroVector;
+	FVector AngularVelocityInDeg = FVector::ZeroVector;
+
+	friend FArchive& operator<<(FArchive& archive, FBallBearingReplayBearingState& state)
+	{
+		return archive << state.Name << state.Transform << state.LinearVelocity << state.AngularVelocityInDeg;
+	}
+};
+
+/**
+ * A recorded play session: the ball bearings' starting states and the player's input and delta time of every frame.
+ * Saved as a small binary file, played back by APlayerBallBearingController.
+ */
+class METALINMOTION_API FBallBearingReplay
+{
+public:
+	TArray<FBallBearingReplayBearingState> InitialStates;
+
+	TArray<FBallBearingReplayFrame> Frames;
+
+	// Store the state of every ball bearing in the world as the starting state
+	void CaptureInitialStates(UWorld* world);
+
+	// Put every ball bearing in the world with a stored state back to it
+	void ApplyInitialStates(UWorld* world) const;
+
+	bool SaveToFile(const FString& fileName);
+
+	bool LoadFromFile(const FString& fileName);
+
+private:
+	// Reject files that aren't replays or are from another format version
+	static constexpr uint32 FileMagic = 0x524D494D;
+	static constexpr uint32 FileVersion = 1;
+};
@@ -6,6 +6,9 @@
 #include "EnhancedInputSubsystems.h"
 #include "Kismet/GameplayStatics.h"
 #include "PlayerBallBearing.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "RenderCore.h"
 
 // bind input actions
 void APlayerBallBearingController::BeginPlay()
@@ -21,11 +24,214 @@ void APlayerBallBearingController::BeginPlay()
 	// Get the EnhancedInputComponent
 	const auto enhancedInputComponent = Cast<UEnhancedInputComponent>(GetPawn()->InputComponent);
 
-	// Get player
-	const auto playerBallBearing = Cast<APlayerBallBearing>(GetPawn());
-
 	// bind actions
-	enhancedInputComponent->BindAction(InputMove, ETriggerEvent::Triggered, playerBallBearing, &APlayerBallBearing::Move);
-	enhancedInputComponent->BindAction(InputDash, ETriggerEvent::Triggered, playerBallBearing, &APlayerBallBearing::Dash);
-	enhancedInputComponent->BindAction(InputJump, ETriggerEvent::Triggered, playerBallBearing, &APlayerBallBearing::Jump);
+	enhancedInputComponent->BindAction(InputMove, ETriggerEvent::Triggered, this, &APlayerBallBearingController::OnMove);
+	enhancedInputComponent->BindAction(InputDash, ETriggerEvent::Triggered, this, &APlayerBallBearingController::OnDash);
+	enhancedInputComponent->BindAction(InputJump, ETriggerEvent::Triggered, this, &APlayerBallBearingController::OnJump);
+
+	StartReplay();
+}
+
+void APlayerBallBearingController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if (ReplayMode == EReplayMode::Recording)
+	{
+		if (Replay.SaveToFile(ReplayFileName))
+		{
+			UE_LOG(LogTemp, Display, TEXT("replay of %d frames saved to %s"), Replay.Frames.Num(), *ReplayFileName);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("couldn't save replay to %s"), *ReplayFileName);
+		}
+	}
+	else if (ReplayMode == EReplayMode::Playing)
+	{
+		FApp::SetUseFixedTimeStep(false);
+	}
+
+	ReplayMode = EReplayMode::None;
+}
+
+APlayerBallBearing* APlayerBallBearingController::GetPlayerBallBearing() const
+{
+	return Cast<APlayerBallBearing>(GetPawn());
+}
+
+void APlayerBallBearingController::OnMove(const FInputActionValue& InputActionValue)
+{
+	// Played back input only
+	if (ReplayMode == EReplayMode::Playing)return;
+
+	if (ReplayMode == EReplayMode::Recording)
+	{
+		RecordingFrame.Flags |= FBallBearingReplayFrame::Move;
+		RecordingFrame.MoveInput = InputActionValue.Get<FVector>();
+	}
+
+	if (APlayerBallBearing* playerBallBearing = GetPlayerBallBearing())
+	{
+		playerBallBearing->Move(InputActionValue);
+	}
+}
+
+void APlayerBallBearingController::OnDash()
+{
+	if (ReplayMode == EReplayMode::Playing)return;
+
+	if (ReplayMode == EReplayMode::Recording)
+	{
+		RecordingFrame.Flags |= FBallBearingReplayFrame::Dash;
+	}
+
+	if (APlayerBallBearing* playerBallBearing = GetPlayerBallBearing())
+	{
+		playerBallBearing->Dash();
+	}
+}
+
+void APlayerBallBearingController::OnJump()
+{
+	if (ReplayMode == EReplayMode::Playing)return;
+
+	if (ReplayMode == EReplayMode::Recording)
+	{
+		RecordingFrame.Flags |= FBallBearingReplayFrame::Jump;
+	}
+
+	if (APlayerBallBearing* playerBallBearing = GetPlayerBallBearing())
+	{
+		playerBallBearing->Jump();
+	}
+}
+
+void APlayerBallBearingController::StartReplay()
+{
+	FString fileName;
+	const bool bRecord = FParse::Value(FCommandLine::Get(), TEXT("BallBearingRecord="), fileName);
+	if (!bRecord && !FParse::Value(FCommandLine::Get(), TEXT("BallBearingReplay="), fileName))return;
+
+	// Relative names go under Saved
+	ReplayFileName = FPaths::IsRelative(fileName) ? FPaths::ProjectSavedDir() / fileName : fileName;
+
+	if (bRecord)
+	{
+		ReplayMode = EReplayMode::Recording;
+		Replay.CaptureInitialStates(GetWorld());
+	}
+	else
+	{
+		if (!Replay.LoadFromFile(ReplayFileName) || Replay.Frames.IsEmpty())
+		{
+			UE_LOG(LogTemp, Error, TEXT("couldn't load replay from %s"), *ReplayFileName);
+			return;
+		}
+
+		ReplayMode = EReplayMode::Playing;
+		Replay.ApplyInitialStates(GetWorld());
+
+		// Every frame runs with the delta time it was recorded with
+		FApp::SetUseFixedTimeStep(true);
+		FApp::SetFixedDeltaTime(Replay.Frames[0].DeltaSeconds);
+
+		PlaybackFrameMs.Reserve(Replay.Frames.Num());
+		PlaybackGameThreadMs.Reserve(Replay.Frames.Num());
+	}
+}
+
+void APlayerBallBearingController::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	if (ReplayMode == EReplayMode::Recording)
+	{
+		// Handlers of this frame's input have run inside Super::PlayerTick
+		RecordingFrame.DeltaSeconds = DeltaTime;
+		Replay.Frames.Add(RecordingFrame);
+		RecordingFrame = FBallBearingReplayFrame();
+	}
+	else if (ReplayMode == EReplayMode::Playing)
+	{
+		PlayReplayFrame();
+	}
+}
+
+void APlayerBallBearingController::PlayReplayFrame()
+{
+	const double now = FPlatformTime::Seconds();
+
+	// Both are known once a frame is over, so what we read now belongs to the frame fed last tick
+	if (PlaybackFrameIndex > 0)
+	{
+		PlaybackFrameMs.Add((now - LastPlaybackFrameSeconds) * 1000.0);
+		PlaybackGameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+	}
+
+	LastPlaybackFrameSeconds = now;
+
+	// One tick past the last frame fills in its timings
+	if (!Replay.Frames.IsValidIndex(PlaybackFrameIndex))
+	{
+		FinishPlayback();
+		return;
+	}
+
+	const FBallBearingReplayFrame& frame = Replay.Frames[PlaybackFrameIndex++];
+
+	if (APlayerBallBearing* playerBallBearing = GetPlayerBallBearing())
+	{
+		if (frame.Flags & FBallBearingReplayFrame::Move)
+		{
+			playerBallBearing->Move(FInputActionValue(frame.MoveInput));
+		}
+
+		if (frame.Flags & FBallBearingReplayFrame::Dash)
+		{
+			playerBallBearing->Dash();
+		}
+
+		if (frame.Flags & FBallBearingReplayFrame::Jump)
+		{
+			playerBallBearing->Jump();
+		}
+	}
+
+	if (Replay.Frames.IsValidIndex(PlaybackFrameIndex))
+	{
+		FApp::SetFixedDeltaTime(Replay.Frames[PlaybackFrameIndex].DeltaSeconds);
+	}
+}
+
+void APlayerBallBearingController::FinishPlayback()
+{
+	ReplayMode = EReplayMode::None;
+	FApp::SetUseFixedTimeStep(false);
+
+	float totalMs = 0.0f;
+	float maxMs = 0.0f;
+
+	TArray<FString> lines;
+	lines.Reserve(PlaybackFrameMs.Num() + 1);
+	lines.Add(TEXT("frame,frameMs,gameThreadMs"));
+
+	for (int i = 0; i < PlaybackFrameMs.Num(); ++i)
+	{
+		lines.Add(FString::Printf(TEXT("%d,%.3f,%.3f"), i, PlaybackFrameMs[i], PlaybackGameThreadMs[i]));
+
+		totalMs += PlaybackFrameMs[i];
+		maxMs = FMath::Max(maxMs, PlaybackFrameMs[i]);
+	}
+
+	const FString timingsFileName = FPaths::ChangeExtension(ReplayFileName, TEXT("timings.csv"));
+	FFileHelper::SaveStringArrayToFile(lines, *timingsFileName);
+
+	UE_LOG(LogTemp, Display, TEXT("replay of %d frames played: %.3f ms average, %.3f ms max frame, timings in %s"),
+		PlaybackFrameMs.Num(), totalMs / FMath::Max(PlaybackFrameMs.Num(), 1), maxMs, *timingsFileName);
+
+	if (FApp::IsUnattended())
+	{
+		FPlatformMisc::RequestExit(false);
+	}
 }
@@ -3,13 +3,18 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "BallBearingReplay.h"
 #include "GameFramework/PlayerController.h"
 #include "PlayerBallBearingController.generated.h"
 
+class APlayerBallBearing;
 class UInputAction;
 class UInputMappingContext;
+struct FInputActionValue;
+
 /**
- * A class for input handling on player
+ * A class for input handling on player.
+ * Records the player's input into a replay with -BallBearingRecord=<file>, plays a replay back instead of real input with -BallBearingReplay=<file>.
  */
 UCLASS()
 class METALINMOTION_API APlayerBallBearingController : public APlayerController
@@ -36,4 +41,51 @@ public:
 private:
 	// bind input actions
 	virtual void BeginPlay() override;
+
+	// save the recording
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Record this frame's input or feed the replay's, after real input is processed
+	virtual void PlayerTick(float DeltaTime) override;
+
+	// Input action handlers, forward to the player ball bearing
+	void OnMove(const FInputActionValue& InputActionValue);
+	void OnDash();
+	void OnJump();
+
+	APlayerBallBearing* GetPlayerBallBearing() const;
+
+	enum class EReplayMode : uint8
+	{
+		None,
+		Recording,
+		Playing
+	};
+
+	EReplayMode ReplayMode = EReplayMode::None;
+
+	FBallBearingReplay Replay;
+
+	FString ReplayFileName;
+
+	// Input of the frame being recorded
+	FBallBearingReplayFrame RecordingFrame;
+
+	// Next replay frame to feed
+	int32 PlaybackFrameIndex = 0;
+
+	// Wall and game thread milliseconds of every played back frame
+	TArray<float> PlaybackFrameMs;
+	TArray<float> PlaybackGameThreadMs;
+
+	double LastPlaybackFrameSeconds = 0.0;
+
+	// Start recording or playing back if asked on the command line
+	void StartReplay();
+
+	// Record the timings of the frame fed last tick, feed the replay's next frame and set the delta time of the frame after it
+	void PlayReplayFrame();
+
+	// Write frame timings next to the replay file, quit if unattended
+	void FinishPlayback();
 };
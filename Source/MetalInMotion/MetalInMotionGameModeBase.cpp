@@ -8,13 +8,12 @@
 #include "BlueprintGameplayTagLibrary.h"
 #include "FCTween.h"
 #include "GameplayTagsManager.h"
-#include "Algo/AllOf.h"
-#include "Algo/AnyOf.h"
 #include "Kismet/GameplayStatics.h"
 
 AMetalInMotionGameModeBase::AMetalInMotionGameModeBase()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	// Goals report their changes, nothing to check every frame
+	PrimaryActorTick.bCanEverTick = false;
 
 	HUDClass = ABallBearingHUD::StaticClass();
 }
@@ -26,32 +25,26 @@ void AMetalInMotionGameModeBase::BeginPlay()
 	UGameplayStatics::PlaySound2D(AActor::GetWorld(), BackgroundMusic);
 }
 
-void AMetalInMotionGameModeBase::Tick(float DeltaSeconds)
+void AMetalInMotionGameModeBase::BeginDestroy()
 {
-	Super::Tick(DeltaSeconds);
+	Super::BeginDestroy();
 
-	CheckBallBearingGoals();
+	FCTween::ClearActiveTweens();
 }
 
-void AMetalInMotionGameModeBase::BeginDestroy()
+void AMetalInMotionGameModeBase::BallBearingGoalChanged(const bool bGoalHasBallBearing)
 {
-	Super::BeginDestroy();
+	SatisfiedBallBearingGoalCount += bGoalHasBallBearing ? 1 : -1;
 
-	FCTween::ClearActiveTweens();
+	CheckBallBearingGoals();
 }
 
 void AMetalInMotionGameModeBase::CheckBallBearingGoals()
 {
 	if (BallBearingGoals.IsEmpty()) return;
 
-	// Does all ball bearing goals have a ball bearing ?
-	const auto allGoalsHasBallBearingGoal = Algo::AllOf(BallBearingGoals, [](const ABallBearingGoal* BallBearingGoal)
-	{
-		return BallBearingGoal->HasBallBearing();
-	});
-
-	// If all ball bearing goals don't have ball bearing and we are counting for game finish 
-	if (!allGoalsHasBallBearingGoal && GameFinishedTimer.IsValid())
+	// If all ball bearing goals don't have ball bearing stop counting for game finish
+	if (SatisfiedBallBearingGoalCount < BallBearingGoals.Num())
 	{
 		GetWorldTimerManager().ClearTimer(GameFinishedTimer);
 
@@ -77,4 +70,9 @@ void AMetalInMotionGameModeBase::GameEnded()
 void AMetalInMotionGameModeBase::AddToBallBearingGoals(ABallBearingGoal* BallBearingGoal)
 {
 	BallBearingGoals.Add(BallBearingGoal);
+
+	if (BallBearingGoal->HasBallBearing())
+	{
+		++SatisfiedBallBearingGoalCount;
+	}
 }
@@ -28,8 +28,8 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Audio)
 	USoundCue* FinishedSound = nullptr;
 
-	// Ball bearing goals calls this when they notified if a ball bearing entered or exited and checks for game end
-	void CheckBallBearingGoals();
+	// Ball bearing goals call this when they gain or lose their ball bearing, checks for game end
+	void BallBearingGoalChanged(bool bGoalHasBallBearing);
 
 	// wait this amount when all ball bearings in place and then game end
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=GameEnd)
@@ -46,13 +46,16 @@ protected:
 	// Play background music beginning of the game
 	virtual void BeginPlay() override;
 
-	// Check ball bearing goals for level end
-	virtual void Tick(float DeltaSeconds) override;
-
 private:
 	// Array of ball bearing goals.
 	TArray<TObjectPtr<ABallBearingGoal>> BallBearingGoals;
 
+	// How many of BallBearingGoals have a ball bearing
+	int32 SatisfiedBallBearingGoalCount = 0;
+
+	// Start or stop waiting for game end depending on if all goals have a ball bearing
+	void CheckBallBearingGoals();
+
 	// Wait after all ball bearings in place
 	FTimerHandle GameFinishedTimer;
 
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Pooler.h"
+#include "Engine/StaticMeshActor.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace PoolBenchmark
+{
+	// How many collections to average per measurement
+	constexpr int32 CollectionCount = 10;
+
+	// Spawn a pooler of given size, collect garbage CollectionCount times and return the average collection time in milliseconds.
+	// outClustered tells if the pool really got a GC cluster
+	double MeasureGarbageCollection(UWorld* world, int32 poolSize, bool bClusterPooledActors, bool& outClustered)
+	{
+		APooler* pooler = world->SpawnActorDeferred<APooler>(APooler::StaticClass(), FTransform::Identity);
+		pooler->ActorToPool = AStaticMeshActor::StaticClass();
+		pooler->SpawnAtStart = poolSize;
+		pooler->bClusterPooledActors = bClusterPooledActors;
+		pooler->FinishSpawning(FTransform::Identity);
+		outClustered = pooler->ArePooledActorsClustered();
+
+		// Settle everything spawned above before measuring
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+
+		double totalSeconds = 0.0;
+		for (int i = 0; i < CollectionCount; ++i)
+		{
+			const double startSeconds = FPlatformTime::Seconds();
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+			totalSeconds += FPlatformTime::Seconds() - startSeconds;
+		}
+
+		pooler->Destroy();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+
+		return totalSeconds * 1000.0 / CollectionCount;
+	}
+}
+
+// Log garbage collection time with and without pooled actor clustering for every given pool size
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkPoolGCCommand(
+	TEXT("MetalInMotion.Pool.BenchmarkGC"),
+	TEXT("Measures garbage collection time of actor pools with and without bClusterPooledActors. \n")
+	TEXT(" Arguments: pool sizes to measure, default 100 1000 5000 \n"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if (!world || !world->HasBegunPlay())
+		{
+			UE_LOG(LogTemp, Error, TEXT("pool gc benchmark needs a world in play"));
+			return;
+		}
+
+		TArray<int32> poolSizes;
+		for (const FString& arg : args)
+		{
+			poolSizes.Add(FCString::Atoi(*arg));
+		}
+
+		if (poolSizes.IsEmpty())
+		{
+			poolSizes = {100, 1000, 5000};
+		}
+
+		for (const int32 poolSize : poolSizes)
+		{
+			bool bClustered;
+			const double unclusteredMs = PoolBenchmark::MeasureGarbageCollection(world, poolSize, false, bClustered);
+			const double clusteredMs = PoolBenchmark::MeasureGarbageCollection(world, poolSize, true, bClustered);
+
+			// Both runs measured the same unclustered pool, there is nothing to compare
+			if (!bClustered)
+			{
+				UE_LOG(LogTemp, Error, TEXT("pool size %d: no gc cluster was created, needs a cooked build with gc.CreateGCClusters enabled. gc %.3f ms unclustered"),
+					poolSize, unclusteredMs);
+				continue;
+			}
+
+			UE_LOG(LogTemp, Display, TEXT("pool size %d: gc %.3f ms unclustered, %.3f ms clustered"), poolSize, unclusteredMs, clusteredMs);
+		}
+	}));
+
+#endif
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PoolTimerWheel.h"
+
+void FPoolTimerWheel::Init(int32 capacity, float tickInterval)
+{
+	for (int32& head : Heads)
+	{
+		head = INDEX_NONE;
+	}
+
+	Next.Init(INDEX_NONE, capacity);
+	Prev.Init(INDEX_NONE, capacity);
+	SlotOf.Init(INDEX_NONE, capacity);
+	ExpireTick.Init(0, capacity);
+
+	TickInterval = FMath::Max(tickInterval, KINDA_SMALL_NUMBER);
+	CurrentTick = 0;
+	Accumulator = 0.0f;
+	ScheduledCount = 0;
+}
+
+void FPoolTimerWheel::Schedule(int32 index, float delaySeconds)
+{
+	if (!SlotOf.IsValidIndex(index))return;
+
+	Cancel(index);
+
+	// Time already accumulated towards the next tick counts, so round up from there
+	const uint64 delayTicks = FMath::Max<int64>(FMath::CeilToInt64((delaySeconds + Accumulator) / TickInterval), 1);
+	ExpireTick[index] = CurrentTick + delayTicks;
+
+	Insert(index);
+	++ScheduledCount;
+}
+
+void FPoolTimerWheel::Cancel(int32 index)
+{
+	if (!IsScheduled(index))return;
+
+	Unlink(index);
+	--ScheduledCount;
+}
+
+void FPoolTimerWheel::Advance(float deltaSeconds, TFunctionRef<void(int32)> onExpired)
+{
+	if (IsEmpty())
+	{
+		// Nothing to expire, don't let stale time shorten the next schedule
+		Accumulator = 0.0f;
+		return;
+	}
+
+	Accumulator += deltaSeconds;
+
+	while (Accumulator >= TickInterval && !IsEmpty())
+	{
+		Accumulator -= TickInterval;
+		++CurrentTick;
+
+		// Bring down entries of the upper levels first, from the highest, when their slot comes around
+		for (int32 level = LevelCount - 1; level > 0; --level)
+		{
+			if ((CurrentTick & ((1ull << (SlotBits * level)) - 1)) == 0)
+			{
+				Cascade(level);
+			}
+		}
+
+		// Everything in the current lowest level slot expires now
+		int32& head = Heads[CurrentTick & SlotMask];
+		while (head != INDEX_NONE)
+		{
+			const int32 expiredIndex = head;
+			Unlink(expiredIndex);
+			--ScheduledCount;
+
+			onExpired(expiredIndex);
+		}
+	}
+}
+
+void FPoolTimerWheel::Insert(int32 index)
+{
+	const uint64 delayTicks = ExpireTick[index] - CurrentTick;
+
+	// Find the lowest level that can hold the delay, anything further than the wheel waits in the last level and cascades again
+	int32 level = 0;
+	while (level < LevelCount - 1 && delayTicks >= (1ull << (SlotBits * (level + 1))))
+	{
+		++level;
+	}
+
+	const uint64 slotTick = delayTicks >= (1ull << (SlotBits * LevelCount)) ? CurrentTick + (1ull << (SlotBits * LevelCount)) - 1 : ExpireTick[index];
+	const int32 slot = level * SlotCount + static_cast<int32>((slotTick >> (SlotBits * level)) & SlotMask);
+
+	Prev[index] = INDEX_NONE;
+	Next[index] = Heads[slot];
+	if (Heads[slot] != INDEX_NONE)
+	{
+		Prev[Heads[slot]] = index;
+	}
+	Heads[slot] = index;
+	SlotOf[index] = slot;
+}
+
+void FPoolTimerWheel::Unlink(int32 index)
+{
+	const int32 slot = SlotOf[index];
+
+	if (Prev[index] != INDEX_NONE)
+	{
+		Next[Prev[index]] = Next[index];
+	}
+	else
+	{
+		Heads[slot] = Next[index];
+	}
+
+	if (Next[index] != INDEX_NONE)
+	{
+		Prev[Next[index]] = Prev[index];
+	}
+
+	Next[index] = Prev[index] = SlotOf[index] = INDEX_NONE;
+}
+
+void FPoolTimerWheel::Cascade(int32 level)
+{
+	int32& head = Heads[level * SlotCount + static_cast<int32>((CurrentTick >> (SlotBits * level)) & SlotMask)];
+
+	// Take the whole slot list first, entries may be inserted back into this level
+	int32 index = head;
+	head = INDEX_NONE;
+
+	while (index != INDEX_NONE)
+	{
+		const int32 nextIndex = Next[index];
+		Next[index] = Prev[index] = SlotOf[index] = INDEX_NONE;
+
+		Insert(index);
+
+		index = nextIndex;
+	}
+}
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Hierarchical timer wheel keyed by pool index, used by APooler to return pooled actors after their lifetime.
+ * Scheduling and cancelling are O(1) and never allocate after Init, entries are linked through per index arrays.
+ */
+class METALINMOTION_API FPoolTimerWheel
+{
+public:
+	// Size the wheel for indices [0, capacity) with the given seconds per tick
+	void Init(int32 capacity, float tickInterval);
+
+	// Expire index after given seconds, replacing its running schedule. Rounded up to at least one tick
+	void Schedule(int32 index, float delaySeconds);
+
+	// Remove index from the wheel if scheduled
+	void Cancel(int32 index);
+
+	bool IsScheduled(int32 index) const
+	{
+		return SlotOf.IsValidIndex(index) && SlotOf[index] != INDEX_NONE;
+	}
+
+	bool IsEmpty() const
+	{
+		return ScheduledCount == 0;
+	}
+
+	// Advance the wheel by deltaSeconds, calling onExpired for every index whose time is up.
+	// onExpired may schedule or cancel any index, including the expired one
+	void Advance(float deltaSeconds, TFunctionRef<void(int32)> onExpired);
+
+private:
+	// Every level has 2^SlotBits slots, a slot of a level covers all the slots of the level below
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotCount = 1 << SlotBits;
+	static constexpr int32 SlotMask = SlotCount - 1;
+	static constexpr int32 LevelCount = 3;
+
+	// Put index into the slot matching its ExpireTick, delay of zero ticks lands in the current slot
+	void Insert(int32 index);
+
+	void Unlink(int32 index);
+
+	// Move every entry of the given level's current slot down to lower levels
+	void Cascade(int32 level);
+
+	// First entry of every slot of every level, level * SlotCount + slot
+	int32 Heads[LevelCount * SlotCount];
+
+	// Intrusive list links, slot and expire tick per index
+	TArray<int32> Next;
+	TArray<int32> Prev;
+	TArray<int32> SlotOf;
+	TArray<uint64> ExpireTick;
+
+	uint64 CurrentTick = 0;
+
+	float TickInterval = 1.0f / 30.0f;
+
+	// Seconds passed that didn't make a whole tick yet
+	float Accumulator = 0.0f;
+
+	int32 ScheduledCount = 0;
+};
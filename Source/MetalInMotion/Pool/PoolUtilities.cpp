@@ -5,11 +5,21 @@
 
 #include "BlueprintGameplayTagLibrary.h"
 #include "Pooler.h"
+#include "PoolerSubsystem.h"
 #include "Kismet/KismetSystemLibrary.h"
 
 // Get associated pooler by given PoolGameplayTag
 APooler* PoolUtilities::GetPoolerByGameplayTag(UWorld* world, const FGameplayTag& poolGameplayTag)
 {
+	// poolers register themselves on BeginPlay, so this is a map lookup most of the time
+	if (const UPoolerSubsystem* poolerSubsystem = world->GetSubsystem<UPoolerSubsystem>())
+	{
+		if (APooler* registeredPooler = poolerSubsystem->FindPooler(poolGameplayTag))
+		{
+			return registeredPooler;
+		}
+	}
+
 	// create a query based on given poolGameplayTag
 	const FGameplayTagQuery gameplayTagQuery = FGameplayTagQuery::BuildQuery(FGameplayTagQueryExpression().AllTagsMatch().AddTag(poolGameplayTag));
 
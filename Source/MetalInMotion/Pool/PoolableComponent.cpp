@@ -3,17 +3,41 @@
 
 #include "PoolableComponent.h"
 
+#include "Pooler.h"
+
+void UPoolableComponent::SetLifetime(float seconds)
+{
+	if (!Pooler || !IsTaken)return;
+
+	Pooler->ScheduleLifetime(this, seconds);
+}
+
+void UPoolableComponent::CancelLifetime()
+{
+	if (!Pooler)return;
+
+	Pooler->CancelLifetime(this);
+}
+
 void UPoolableComponent::Taken()
 {
 	IsTaken = true;
 }
 
 void UPoolableComponent::ReturnToPool()
+{
+	if (!Pooler)return;
+
+	Pooler->ReturnToPool(this);
+}
+
+void UPoolableComponent::Returned()
 {
 	IsTaken = false;
 }
 
-void UPoolableComponent::Init(APooler* pooler)
+void UPoolableComponent::Init(APooler* pooler, int32 poolIndex)
 {
 	Pooler = pooler;
+	PoolIndex = poolIndex;
 }
@@ -7,6 +7,9 @@
 #include "PoolableComponent.generated.h"
 
 class APooler;
+class UPoolableComponent;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPooledLifetimeExpired, UPoolableComponent*, PoolableComponent);
 
 UCLASS(ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class METALINMOTION_API UPoolableComponent : public UActorComponent
@@ -14,24 +17,55 @@ class METALINMOTION_API UPoolableComponent : public UActorComponent
 	GENERATED_BODY()
 
 public:
-	void ReturnToPool();
+	// Owner returns to the pool this many seconds after it is taken, 0 or less keeps it until returned
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Pooling")
+	float Lifetime = 0.0f;
 
-	void Taken();
+	// Called right before the owner is returned to the pool because its lifetime ended.
+	// Setting a new lifetime from here keeps the owner out of the pool
+	UPROPERTY(BlueprintAssignable, Category="Pooling")
+	FOnPooledLifetimeExpired OnLifetimeExpired;
+
+	// Return the owner to the pool after given seconds, replacing the running lifetime
+	UFUNCTION(BlueprintCallable, Category="Pooling")
+	void SetLifetime(float seconds);
+
+	// Stop the running lifetime, owner stays until returned
+	UFUNCTION(BlueprintCallable, Category="Pooling")
+	void CancelLifetime();
+
+	// Give the owner back to its pooler, same as APooler::ReturnToPool
+	void ReturnToPool();
 
 	bool GetIsTaken() const
 	{
 		return IsTaken;
 	}
 
-	void Init(APooler* pooler);
+	void Init(APooler* pooler, int32 poolIndex);
 
 	APooler* GetPooler() const
 	{
 		return Pooler;
 	}
 
+	// Index of this component in its pooler's pooled actors
+	int32 GetPoolIndex() const
+	{
+		return PoolIndex;
+	}
+
 private:
-	bool IsTaken;
+	// Taken state is only changed by the pooler, together with its free indices and lifetimes
+	friend APooler;
+
+	void Taken();
+
+	void Returned();
+
+	bool IsTaken = false;
 
 	TObjectPtr<APooler> Pooler;
+
+	int32 PoolIndex = INDEX_NONE;
 };
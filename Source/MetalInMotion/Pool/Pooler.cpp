@@ -4,13 +4,49 @@
 #include "Pooler.h"
 
 #include "PoolableComponent.h"
+#include "PoolerSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+#include "UObject/UObjectArray.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pooler Tick"), STAT_PoolerTick, STATGROUP_Game);
+
+APooler::APooler()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
 
 // Spawn the to be pooled objects
 void APooler::BeginPlay()
 {
 	Super::BeginPlay();
 
+	if (PoolMode == EPoolMode::InstancedStaticMesh)
+	{
+		SpawnPooledInstances();
+	}
+	else
+	{
+		SpawnPooledActors();
+		ClusterPooledActors();
+	}
+
+	// Fill the free stack in reverse so the first pooled objects are taken first
+	FreeIndices.Reserve(GetCapacity());
+	for (int i = GetCapacity() - 1; i >= 0; --i)
+	{
+		FreeIndices.Push(i);
+	}
+
+	LifetimeWheel.Init(GetCapacity(), LifetimeTickInterval);
+
+	GetWorld()->GetSubsystem<UPoolerSubsystem>()->Register(this);
+}
+
+void APooler::SpawnPooledActors()
+{
 	// Get world
 	UWorld* world = GetWorld();
 
@@ -31,10 +67,130 @@ void APooler::BeginPlay()
 		}
 
 		// Add spawnedActor's UPoolableComponent to the list
-		PooledActors.Add(poolableComponent);
+		const int32 poolIndex = PooledActors.Add(poolableComponent);
 		// Init this pooler to poolableComponent
-		poolableComponent->Init(this);
+		poolableComponent->Init(this, poolIndex);
+	}
+}
+
+void APooler::ClusterPooledActors()
+{
+	if (!CanBeClusterRoot() || PooledActors.IsEmpty())return;
+
+	// Editor and uncooked builds don't create clusters
+	const auto createClusters = IConsoleManager::Get().FindConsoleVariable(TEXT("gc.CreateGCClusters"));
+	if (!createClusters || createClusters->GetInt() == 0)return;
+
+	CreateCluster();
+
+	// Pooled actors live as long as the pool, so GC can mark them reachable with the pooler instead of walking each of them
+	for (const UPoolableComponent* poolableComponent : PooledActors)
+	{
+		poolableComponent->GetOwner()->AddToCluster(this);
+	}
+
+	bPooledActorsClustered = true;
+}
+
+void APooler::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	GetWorld()->GetSubsystem<UPoolerSubsystem>()->Unregister(this);
+
+	LifetimeWheel.Init(0, LifetimeTickInterval);
+	FreeIndices.Empty();
+
+	if (EndPlayReason != EEndPlayReason::Destroyed)return;
+
+	// Cluster members can't be destroyed one by one
+	if (bPooledActorsClustered)
+	{
+		GUObjectClusters.DissolveCluster(this);
+		bPooledActorsClustered = false;
+	}
+
+	for (const UPoolableComponent* poolableComponent : PooledActors)
+	{
+		if (IsValid(poolableComponent))
+		{
+			poolableComponent->GetOwner()->Destroy();
+		}
 	}
+
+	PooledActors.Empty();
+}
+
+void APooler::SpawnPooledInstances()
+{
+	// One component draws every pooled instance, they have no collision because they are visual only
+	InstancedMeshComponent = NewObject<UInstancedStaticMeshComponent>(this, TEXT("PooledInstances"));
+	if (GetRootComponent())
+	{
+		InstancedMeshComponent->SetupAttachment(GetRootComponent());
+	}
+	else
+	{
+		SetRootComponent(InstancedMeshComponent);
+	}
+	InstancedMeshComponent->SetStaticMesh(InstancedMesh);
+	InstancedMeshComponent->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	InstancedMeshComponent->SetMobility(EComponentMobility::Movable);
+	InstancedMeshComponent->RegisterComponent();
+	AddInstanceComponent(InstancedMeshComponent);
+
+	// Every instance starts hidden, the instance index is the pool index
+	TArray<FTransform> hiddenTransforms;
+	hiddenTransforms.Init(GetHiddenInstanceTransform(), SpawnAtStart);
+	InstancedMeshComponent->AddInstances(hiddenTransforms, false, true);
+
+	TakenInstances.Init(false, SpawnAtStart);
+}
+
+void APooler::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_PoolerTick);
+	FScopedDurationTimer tickTimer(GetWorld()->GetSubsystem<UPoolerSubsystem>()->TickSeconds);
+
+	LifetimeWheel.Advance(DeltaSeconds, [&](const int32 expiredIndex)
+	{
+		if (PoolMode == EPoolMode::InstancedStaticMesh)
+		{
+			ReturnInstanceToPool(expiredIndex);
+			return;
+		}
+
+		UPoolableComponent* expiredPoolableComponent = PooledActors[expiredIndex];
+		expiredPoolableComponent->OnLifetimeExpired.Broadcast(expiredPoolableComponent);
+
+		// Listeners may have extended the lifetime
+		if (LifetimeWheel.IsScheduled(expiredIndex))return;
+
+		ReturnToPool(expiredPoolableComponent);
+	});
+
+	if (LifetimeWheel.IsEmpty())
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void APooler::ScheduleLifetime(const UPoolableComponent* poolableComponent, float seconds)
+{
+	if (!poolableComponent || poolableComponent->GetPooler() != this || !poolableComponent->GetIsTaken())return;
+
+	LifetimeWheel.Schedule(poolableComponent->GetPoolIndex(), seconds);
+
+	SetActorTickEnabled(true);
+}
+
+void APooler::CancelLifetime(const UPoolableComponent* poolableComponent)
+{
+	if (!poolableComponent || poolableComponent->GetPooler() != this)return;
+
+	LifetimeWheel.Cancel(poolableComponent->GetPoolIndex());
 }
 
 void APooler::ResetPooledObj(AActor* pooledActor)
@@ -45,6 +201,7 @@ void APooler::ResetPooledObj(AActor* pooledActor)
 	// Set spawned actor world outliner folder and hide it
 	pooledActor->SetFolderPath(FName("/Pools/" + UKismetSystemLibrary::GetDisplayName(this)));
 	pooledActor->SetActorHiddenInGame(true);
+	pooledActor->SetActorEnableCollision(false);
 
 	// Reset position, scale and rotation
 	pooledActor->SetActorRelativeLocation(FVector::ZeroVector);
@@ -52,26 +209,220 @@ void APooler::ResetPooledObj(AActor* pooledActor)
 	pooledActor->SetActorRotation(FRotator::ZeroRotator);
 }
 
+AActor* APooler::TakeFreePooledObj()
+{
+	if (FreeIndices.IsEmpty())
+	{
+		++Stats.ExhaustedCount;
+		UE_LOG(LogTemp, Warning, TEXT("pooler %s is exhausted"), *GameplayTag.GetTagName().ToString());
+		return nullptr;
+	}
+
+	UPoolableComponent* takenPoolableComponent = PooledActors[FreeIndices.Pop(false)];
+	takenPoolableComponent->Taken();
+	RecordAcquire();
+
+	if (takenPoolableComponent->Lifetime > 0.0f)
+	{
+		ScheduleLifetime(takenPoolableComponent, takenPoolableComponent->Lifetime);
+	}
+
+	return takenPoolableComponent->GetOwner();
+}
+
+void APooler::ActivatePooledObj(AActor* pooledActor)
+{
+	pooledActor->SetActorHiddenInGame(false);
+	pooledActor->SetActorEnableCollision(true);
+}
+
 // Get pooled object from the pool
 AActor* APooler::GetPooledObj()
 {
-	const TObjectPtr<UPoolableComponent>* foundPoolableComponent = PooledActors.FindByPredicate([&](const UPoolableComponent* poolableComponent)
+	if (PoolMode != EPoolMode::Actors)
 	{
-		return !poolableComponent->GetIsTaken();
-	});
+		UE_LOG(LogTemp, Error, TEXT("pooler %s pools instances, use GetPooledInstance"), *GameplayTag.GetTagName().ToString());
+		return nullptr;
+	}
 
-	UPoolableComponent* returnedPoolableComponent = *foundPoolableComponent;
-	returnedPoolableComponent->Taken();
+	AActor* returnedActor = TakeFreePooledObj();
+	if (!returnedActor)return nullptr;
 
-	AActor* returnedActor = returnedPoolableComponent->GetOwner();
-	returnedActor->SetActorHiddenInGame(false);
+	ActivatePooledObj(returnedActor);
 
 	return returnedActor;
 }
 
-void APooler::ReturnToPool(const UPoolableComponent* poolableComponent)
+int32 APooler::GetPooledObjs(int32 count, TArray<AActor*>& outActors, const TArray<FTransform>& transforms)
+{
+	outActors.Reset();
+
+	if (PoolMode != EPoolMode::Actors)
+	{
+		UE_LOG(LogTemp, Error, TEXT("pooler %s pools instances, use GetPooledInstances"), *GameplayTag.GetTagName().ToString());
+		return 0;
+	}
+
+	// Take every free slot first so a burst is served from a single pass over the free stack
+	const int32 takenCount = FMath::Clamp(count, 0, FreeIndices.Num());
+	if (takenCount < count)
+	{
+		++Stats.ExhaustedCount;
+		UE_LOG(LogTemp, Warning, TEXT("pooler %s can only give %d of %d requested actors"), *GameplayTag.GetTagName().ToString(), takenCount, count);
+	}
+
+	outActors.Reserve(takenCount);
+	for (int i = 0; i < takenCount; ++i)
+	{
+		outActors.Add(TakeFreePooledObj());
+	}
+
+	// Place the taken actors before showing them so nothing renders or collides at the pool location
+	const int32 placedCount = FMath::Min(takenCount, transforms.Num());
+	for (int i = 0; i < placedCount; ++i)
+	{
+		outActors[i]->SetActorTransform(transforms[i], false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	for (AActor* takenActor : outActors)
+	{
+		ActivatePooledObj(takenActor);
+	}
+
+	return takenCount;
+}
+
+void APooler::ReturnToPool(UPoolableComponent* poolableComponent)
 {
-	if (!PooledActors.Contains(poolableComponent))return;
+	// Only take back our own actors and only once
+	if (!poolableComponent || poolableComponent->GetPooler() != this || !poolableComponent->GetIsTaken())return;
+
+	poolableComponent->Returned();
+
+	// Returned early, the lifetime must not fire for the next taker
+	LifetimeWheel.Cancel(poolableComponent->GetPoolIndex());
 
 	ResetPooledObj(poolableComponent->GetOwner());
+
+	FreeIndices.Push(poolableComponent->GetPoolIndex());
+	++Stats.ReleaseCount;
+}
+
+void APooler::ReturnToPoolBatch(const TArray<AActor*>& actors)
+{
+	for (const AActor* actor : actors)
+	{
+		if (!IsValid(actor))continue;
+
+		ReturnToPool(actor->FindComponentByClass<UPoolableComponent>());
+	}
+}
+
+FTransform APooler::GetHiddenInstanceTransform() const
+{
+	// Instances can't be hidden one by one, a zero scale instance at the pooler draws nothing
+	return FTransform(FQuat::Identity, GetActorLocation(), FVector::ZeroVector);
+}
+
+int32 APooler::TakeFreeInstance(const FTransform& transform, float lifetime)
+{
+	if (PoolMode != EPoolMode::InstancedStaticMesh)
+	{
+		UE_LOG(LogTemp, Error, TEXT("pooler %s pools actors, use GetPooledObj"), *GameplayTag.GetTagName().ToString());
+		return INDEX_NONE;
+	}
+
+	if (FreeIndices.IsEmpty())
+	{
+		++Stats.ExhaustedCount;
+		UE_LOG(LogTemp, Warning, TEXT("pooler %s is exhausted"), *GameplayTag.GetTagName().ToString());
+		return INDEX_NONE;
+	}
+
+	const int32 instanceIndex = FreeIndices.Pop(false);
+	TakenInstances[instanceIndex] = true;
+	RecordAcquire();
+
+	InstancedMeshComponent->UpdateInstanceTransform(instanceIndex, transform, true, false, true);
+
+	if (lifetime > 0.0f)
+	{
+		LifetimeWheel.Schedule(instanceIndex, lifetime);
+		SetActorTickEnabled(true);
+	}
+
+	return instanceIndex;
+}
+
+int32 APooler::GetPooledInstance(const FTransform& transform, float lifetime)
+{
+	const int32 instanceIndex = TakeFreeInstance(transform, lifetime);
+
+	if (instanceIndex != INDEX_NONE)
+	{
+		InstancedMeshComponent->MarkRenderStateDirty();
+	}
+
+	return instanceIndex;
+}
+
+int32 APooler::GetPooledInstances(const TArray<FTransform>& transforms, TArray<int32>& outInstanceIndices, float lifetime)
+{
+	outInstanceIndices.Reset(transforms.Num());
+
+	for (const FTransform& transform : transforms)
+	{
+		const int32 instanceIndex = TakeFreeInstance(transform, lifetime);
+		if (instanceIndex == INDEX_NONE)break;
+
+		outInstanceIndices.Add(instanceIndex);
+	}
+
+	// Render state is rebuilt once for the whole burst
+	if (!outInstanceIndices.IsEmpty())
+	{
+		InstancedMeshComponent->MarkRenderStateDirty();
+	}
+
+	return outInstanceIndices.Num();
+}
+
+bool APooler::HideInstance(int32 instanceIndex)
+{
+	// Only take back taken instances and only once
+	if (!TakenInstances.IsValidIndex(instanceIndex) || !TakenInstances[instanceIndex])return false;
+
+	TakenInstances[instanceIndex] = false;
+
+	LifetimeWheel.Cancel(instanceIndex);
+
+	InstancedMeshComponent->UpdateInstanceTransform(instanceIndex, GetHiddenInstanceTransform(), true, false, true);
+
+	FreeIndices.Push(instanceIndex);
+	++Stats.ReleaseCount;
+
+	return true;
+}
+
+void APooler::ReturnInstanceToPool(int32 instanceIndex)
+{
+	if (HideInstance(instanceIndex))
+	{
+		InstancedMeshComponent->MarkRenderStateDirty();
+	}
+}
+
+void APooler::ReturnInstancesToPool(const TArray<int32>& instanceIndices)
+{
+	bool bAnyReturned = false;
+
+	for (const int32 instanceIndex : instanceIndices)
+	{
+		bAnyReturned |= HideInstance(instanceIndex);
+	}
+
+	if (bAnyReturned)
+	{
+		InstancedMeshComponent->MarkRenderStateDirty();
+	}
 }
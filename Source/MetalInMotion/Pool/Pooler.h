@@ -5,28 +5,143 @@
 #include "CoreMinimal.h"
 #include "GameplayTagAssetInterface.h"
 #include "GameplayTagContainer.h"
+#include "PoolTimerWheel.h"
 #include "GameFramework/Actor.h"
 #include "Pooler.generated.h"
 
 class UPoolableComponent;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+UENUM()
+enum class EPoolMode : uint8
+{
+	// Spawn ActorToPool actors and hand them out
+	Actors,
+	// Hand out instances of InstancedMesh drawn by a single instanced static mesh component, for visual only pooled objects
+	InstancedStaticMesh
+};
+
+// Usage counters of a pooler, for watching pool pressure
+struct FPoolStats
+{
+	// Most objects taken at the same time
+	int32 PeakInUse = 0;
+
+	int64 AcquireCount = 0;
+
+	int64 ReleaseCount = 0;
+
+	// How many times an acquire found the pool empty
+	int64 ExhaustedCount = 0;
+};
+
 UCLASS()
 class METALINMOTION_API APooler : public AActor, public IGameplayTagAssetInterface
 {
 	GENERATED_BODY()
 
 public:
-	// The actor to pool
+	// Ticks only while pooled actors have a running lifetime
+	APooler();
+
+	// Pool actors or instances of a single mesh
 	UPROPERTY(EditAnywhere, Category="Pooling")
+	EPoolMode PoolMode = EPoolMode::Actors;
+
+	// The actor to pool
+	UPROPERTY(EditAnywhere, Category="Pooling", meta=(EditCondition="PoolMode == EPoolMode::Actors"))
 	TSubclassOf<AActor> ActorToPool = nullptr;
 
-	// How many ActorToPool to spawn in BeginPlay
+	// The mesh to pool instances of
+	UPROPERTY(EditAnywhere, Category="Pooling", meta=(EditCondition="PoolMode == EPoolMode::InstancedStaticMesh"))
+	TObjectPtr<UStaticMesh> InstancedMesh = nullptr;
+
+	// How many ActorToPool or InstancedMesh instances to spawn in BeginPlay
 	UPROPERTY(EditAnywhere, Category="Pooling")
 	int SpawnAtStart;
 
-	// Get pooled object from the pool
+	// Get pooled object from the pool, nullptr if the pool is exhausted
+	UFUNCTION(BlueprintCallable, Category="Pooling")
 	AActor* GetPooledObj();
 
-	void ReturnToPool(const UPoolableComponent* poolableComponent);
+	// Get up to count pooled objects from the pool in one pass, placing each one at the transform with the same index if given.
+	// Returns how many objects were taken
+	UFUNCTION(BlueprintCallable, Category="Pooling", meta=(AutoCreateRefTerm="transforms"))
+	int32 GetPooledObjs(int32 count, TArray<AActor*>& outActors, const TArray<FTransform>& transforms);
+
+	void ReturnToPool(UPoolableComponent* poolableComponent);
+
+	// Return all given pooled actors to the pool in one pass
+	UFUNCTION(BlueprintCallable, Category="Pooling")
+	void ReturnToPoolBatch(const TArray<AActor*>& actors);
+
+	// Get an instance from the pool at given world transform, returned after lifetime seconds if positive.
+	// Returns the instance index or INDEX_NONE if the pool is exhausted
+	UFUNCTION(BlueprintCallable, Category="Pooling|Instanced")
+	int32 GetPooledInstance(const FTransform& transform, float lifetime = 0.0f);
+
+	// Get an instance for every given world transform with one render state update. Returns how many instances were taken
+	UFUNCTION(BlueprintCallable, Category="Pooling|Instanced")
+	int32 GetPooledInstances(const TArray<FTransform>& transforms, TArray<int32>& outInstanceIndices, float lifetime = 0.0f);
+
+	UFUNCTION(BlueprintCallable, Category="Pooling|Instanced")
+	void ReturnInstanceToPool(int32 instanceIndex);
+
+	// Return all given instances to the pool with one render state update
+	UFUNCTION(BlueprintCallable, Category="Pooling|Instanced")
+	void ReturnInstancesToPool(const TArray<int32>& instanceIndices);
+
+	// The component drawing the pooled instances, nullptr when pooling actors
+	UFUNCTION(BlueprintPure, Category="Pooling|Instanced")
+	UInstancedStaticMeshComponent* GetInstancedMeshComponent() const
+	{
+		return InstancedMeshComponent;
+	}
+
+	// How many objects this pool holds
+	int32 GetCapacity() const
+	{
+		return PoolMode == EPoolMode::InstancedStaticMesh ? TakenInstances.Num() : PooledActors.Num();
+	}
+
+	// How many objects are taken right now
+	int32 GetInUseCount() const
+	{
+		return GetCapacity() - FreeIndices.Num();
+	}
+
+	const FPoolStats& GetStats() const
+	{
+		return Stats;
+	}
+
+	// Seconds per tick of the lifetime timer wheel, lifetimes are rounded up to this
+	UPROPERTY(EditAnywhere, Category="Pooling|Lifetime")
+	float LifetimeTickInterval = 1.0f / 30.0f;
+
+	// Put the pooled actors into a GC cluster rooted at this pooler so reachability analysis handles the pool as one object.
+	// Only takes effect where GC clusters are created, which is cooked builds with gc.CreateGCClusters enabled.
+	// Clustered pooled actors must not be destroyed on their own, only the pooler destroys them, after dissolving the cluster
+	UPROPERTY(EditAnywhere, Category="Pooling|GC")
+	bool bClusterPooledActors = false;
+
+	// Did BeginPlay put the pooled actors into a GC cluster ?
+	bool ArePooledActorsClustered() const
+	{
+		return bPooledActorsClustered;
+	}
+
+	virtual bool CanBeClusterRoot() const override
+	{
+		return bClusterPooledActors && PoolMode == EPoolMode::Actors;
+	}
+
+	// Return the given taken component's owner to the pool after given seconds
+	void ScheduleLifetime(const UPoolableComponent* poolableComponent, float seconds);
+
+	// Stop the running lifetime of the given component
+	void CancelLifetime(const UPoolableComponent* poolableComponent);
 
 	// The gameplay tag for finding this pooler
 	UPROPERTY(EditAnywhere, Category="Pooling")
@@ -58,7 +173,59 @@ protected:
 	// Spawn the to be pooled objects
 	virtual void BeginPlay() override;
 
+	// Return pooled actors whose lifetime ended
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Destroy the pooled actors with the pooler
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	TArray<TObjectPtr<UPoolableComponent>> PooledActors;
 
+	// Indices of not taken PooledActors, used as a stack so taking from the pool doesn't need a scan
+	TArray<int32> FreeIndices;
+
+	// Running lifetimes of taken PooledActors, by pool index
+	FPoolTimerWheel LifetimeWheel;
+
+	FPoolStats Stats;
+
 	void ResetPooledObj(AActor* pooledActor);
+
+private:
+	void SpawnPooledActors();
+
+	void SpawnPooledInstances();
+
+	// Count a successful acquire
+	void RecordAcquire()
+	{
+		++Stats.AcquireCount;
+		Stats.PeakInUse = FMath::Max(Stats.PeakInUse, GetInUseCount());
+	}
+
+	// Create the GC cluster of the pooled actors if bClusterPooledActors
+	void ClusterPooledActors();
+
+	bool bPooledActorsClustered = false;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UInstancedStaticMeshComponent> InstancedMeshComponent = nullptr;
+
+	// Taken state of every instance, by instance index
+	TBitArray<> TakenInstances;
+
+	// Where and how a not taken instance is kept
+	FTransform GetHiddenInstanceTransform() const;
+
+	// Pop a free instance and move it to transform without updating render state, INDEX_NONE if the pool is exhausted
+	int32 TakeFreeInstance(const FTransform& transform, float lifetime);
+
+	// Move the instance back to the pool without updating render state, false if it wasn't taken
+	bool HideInstance(int32 instanceIndex);
+
+	// Pop a free pooled actor from FreeIndices and mark it taken, nullptr if the pool is exhausted
+	AActor* TakeFreePooledObj();
+
+	// Show the taken actor and enable its collision
+	static void ActivatePooledObj(AActor* pooledActor);
 };
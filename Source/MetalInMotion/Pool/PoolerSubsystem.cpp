@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "PoolerSubsystem.h"
+
+#include "Pooler.h"
+
+void UPoolerSubsystem::Register(APooler* pooler)
+{
+	if (Poolers.Contains(pooler->GameplayTag))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("more than one pooler with tag %s, keeping the first one"), *pooler->GameplayTag.GetTagName().ToString());
+		return;
+	}
+
+	Poolers.Add(pooler->GameplayTag, pooler);
+}
+
+void UPoolerSubsystem::Unregister(const APooler* pooler)
+{
+	if (FindPooler(pooler->GameplayTag) == pooler)
+	{
+		Poolers.Remove(pooler->GameplayTag);
+	}
+}
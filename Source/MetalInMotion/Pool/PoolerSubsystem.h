@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PoolerSubsystem.generated.h"
+
+class APooler;
+
+/**
+ * Keeps every APooler of the world by its gameplay tag
+ */
+UCLASS()
+class METALINMOTION_API UPoolerSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Poolers register themselves in BeginPlay
+	void Register(APooler* pooler);
+
+	// Poolers unregister themselves in EndPlay
+	void Unregister(const APooler* pooler);
+
+	// Get the pooler registered with given tag, nullptr if none
+	APooler* FindPooler(const FGameplayTag& poolGameplayTag) const
+	{
+		const TObjectPtr<APooler>* foundPooler = Poolers.Find(poolGameplayTag);
+		return foundPooler ? foundPooler->Get() : nullptr;
+	}
+
+	const TMap<FGameplayTag, TObjectPtr<APooler>>& GetPoolers() const
+	{
+		return Poolers;
+	}
+
+	// Seconds every pooler spent ticking since the last ResetTickSeconds, for stress measurements
+	double GetTickSeconds() const
+	{
+		return TickSeconds;
+	}
+
+	void ResetTickSeconds()
+	{
+		TickSeconds = 0.0;
+	}
+
+private:
+	// Poolers time their ticks into TickSeconds
+	friend APooler;
+
+	double TickSeconds = 0.0;
+
+	UPROPERTY()
+	TMap<FGameplayTag, TObjectPtr<APooler>> Poolers;
+};
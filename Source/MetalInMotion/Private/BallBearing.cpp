@@ -3,6 +3,7 @@
 
 #include "BallBearing.h"
 
+#include "BallBearingMovementSubsystem.h"
 #include "Kismet/KismetSystemLibrary.h"
 
 // Sets default values
@@ -22,3 +23,14 @@ void ABallBearing::BeginPlay()
 
 	InitialLocation = BallMesh->GetComponentLocation();
 }
+
+void ABallBearing::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if (IsMovementRegistered())
+	{
+		MovementSubsystem->Unregister(MovementIndex);
+		MovementIndex = INDEX_NONE;
+	}
+}
@@ -3,8 +3,8 @@
 
 #include "BallBearingGoal.h"
 
+#include "BallBearingGoalSubsystem.h"
 #include "PlayerBallBearing.h"
-#include "Algo/AnyOf.h"
 #include "Components/BillboardComponent.h"
 #include "Components/SphereComponent.h"
 #include "Kismet/GameplayStatics.h"
@@ -14,7 +14,8 @@
 
 ABallBearingGoal::ABallBearingGoal()
 {
-	PrimaryActorTick.bCanEverTick = true;
+	// UBallBearingGoalSubsystem does our per frame work while ball bearings are in range
+	PrimaryActorTick.bCanEverTick = false;
 }
 
 void ABallBearingGoal::PostInitializeComponents()
@@ -24,105 +25,129 @@ void ABallBearingGoal::PostInitializeComponents()
 	GetSpriteComponent()->SetHiddenInGame(true);
 
 	GetCollisionComponent()->SetHiddenInGame(true);
+
+	UpdateSquaredThresholds();
 }
 
-void ABallBearingGoal::BeginPlay()
+#if WITH_EDITOR
+void ABallBearingGoal::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
 {
-	Super::BeginPlay();
+	Super::PostEditChangeProperty(PropertyChangedEvent);
 
-	Cast<AMetalInMotionGameModeBase>(UGameplayStatics::GetGameMode(GetWorld()))->AddToBallBearingGoals(this);
+	const FName propertyName = PropertyChangedEvent.GetPropertyName();
+	if (propertyName == GET_MEMBER_NAME_CHECKED(ABallBearingGoal, MaxDistanceToHasBallBearing) || propertyName == GET_MEMBER_NAME_CHECKED(ABallBearingGoal, LessThanVelSizeToHasBallBearing))
+	{
+		UpdateSquaredThresholds();
+	}
+}
+#endif
 
-	HandleHasBallBearingVfX();
+void ABallBearingGoal::UpdateSquaredThresholds()
+{
+	MaxDistanceToHasBallBearingSquared = FMath::Square(MaxDistanceToHasBallBearing);
+	LessThanVelSizeToHasBallBearingSquared = FMath::Square(LessThanVelSizeToHasBallBearing);
 }
 
-void ABallBearingGoal::Tick(float DeltaSeconds)
+void ABallBearingGoal::BeginPlay()
 {
-	Super::Tick(DeltaSeconds);
+	Super::BeginPlay();
 
-	HandleBallMagnetism();
+	if (bCountsForLevelEnd)
+	{
+		GameMode = Cast<AMetalInMotionGameModeBase>(UGameplayStatics::GetGameMode(GetWorld()));
+		GameMode->AddToBallBearingGoals(this);
+	}
+
+	GoalSubsystem = GetWorld()->GetSubsystem<UBallBearingGoalSubsystem>();
+	if (GoalSubsystem)
+	{
+		GoalSubsystem->MarkMagnetismFieldDirty();
+	}
 
-	CheckHasBallBearing();
+	UpdateVfx(GetWorld()->GetTimeSeconds());
 }
 
-void ABallBearingGoal::HandleBallMagnetism()
+void ABallBearingGoal::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	const auto ourLocation = GetActorLocation();
-	const auto sphereRadius = Cast<USphereComponent>(GetCollisionComponent())->GetScaledSphereRadius();
-	auto magnetism = Magnetism;
+	Super::EndPlay(EndPlayReason);
 
-	// If we're cheating then give our goals extra magnetism.
-	const auto extraForce = IConsoleManager::Get().FindConsoleVariable(TEXT("MetalInMotion.ExtraMagnetism"));
-	if (extraForce && extraForce->GetInt() != 0)
+	if (GoalSubsystem)
 	{
-		magnetism *= 4.0f;
+		GoalSubsystem->Unregister(this);
+		GoalSubsystem->CancelVfxUpdate(this);
+		GoalSubsystem->MarkMagnetismFieldDirty();
 	}
+}
 
-	// Calculate force on every ball bearing in our range and apply it
-	for (const ABallBearing* ballBearing : BallBearings)
-	{
-		const auto difference = ourLocation - ballBearing->GetActorLocation();
-		const auto distance = difference.Size();
+void ABallBearingGoal::UpdateNextCheckTime(const bool bMeetsConditions, const double now)
+{
+	// A confirmed ball bearing still slow in our center is resting. Our magnetism would only keep its body awake, so leave it alone for a while
+	const bool bResting = bHasBallBearing && bMeetsConditions;
 
-		auto direction = difference;
-		direction.Normalize();
+	NextCheckTime = bResting ? now + RestingCheckInterval : 0.0;
+}
 
-		const auto ratio = distance / sphereRadius;
-		const auto force = (1.0f - ratio) * magnetism * direction;
+void ABallBearingGoal::SetAwake(const bool bAwake)
+{
+	NextCheckTime = 0.0;
 
-		ballBearing->BallMesh->AddForce(force);
+	// Overlaps can come in before BeginPlay, from ball bearings spawned inside us or initial overlaps
+	if (!GoalSubsystem)
+	{
+		GoalSubsystem = GetWorld()->GetSubsystem<UBallBearingGoalSubsystem>();
+		if (!GoalSubsystem)return;
+	}
+
+	if (bAwake)
+	{
+		GoalSubsystem->Register(this);
+	}
+	else
+	{
+		GoalSubsystem->Unregister(this);
 	}
 }
 
-void ABallBearingGoal::CheckHasBallBearing()
+void ABallBearingGoal::UpdateHasBallBearing(const bool bMeetsConditions, const double now)
 {
-	const auto ourLocation = GetActorLocation();
-
-	// Does any of the ball bearings in our range meets conditions for has ball bearing ?
-	const auto bTempHasBallBearing = Algo::AnyOf(BallBearings, [&,ourLocation](const ABallBearing* ballBearing)
+	// The wait runs out from when the ball bearing first met conditions, whatever they are by then
+	if (bPotentialHasBallBearing && !bHasBallBearing)
 	{
-		const auto difference = ourLocation - ballBearing->GetActorLocation();
-		const auto distance = difference.Size();
+		if (now - PotentialHasBallBearingStartTime < TimeToWaitForConfirmHasBallBearing)return;
 
-		if (distance <= MaxDistanceToHasBallBearing && ballBearing->GetVelocity().Size() <= LessThanVelSizeToHasBallBearing)
-		{
-			return true;
-		}
+		// We have confirmed that we have a ball bearing, conditions are compared again on the next check
+		bHasBallBearing = true;
+
+		HandleHasBallBearingVfX();
+		NotifyGameModeHasBallBearingChanged();
+		return;
+	}
 
-		return false;
-	});
+	// If our ball bearing having status didn't change
+	if (bHasBallBearing == bMeetsConditions)return;
 
-	// If our ball bearing having status is changed
-	if (bHasBallBearing != bTempHasBallBearing)
+	if (bMeetsConditions) // We didn't have before, now we have it
 	{
-		if (bTempHasBallBearing) // We didn't have before, now we have it
-		{
-			// We have potential, don't do anything
-			// We need this because we don't set has ball bearing true without waiting
-			if (bPotentialHasBallBearing)
-			{
-				return;
-			}
-
-			bPotentialHasBallBearing = true;
-
-			GetWorldTimerManager().SetTimer(ConfirmHasBallBearingTimerHandle, FTimerDelegate::CreateLambda([=]
-			{
-				// We have confirmed that we have a ball bearing
-				bHasBallBearing = true;
-				HandleHasBallBearingVfX();
-			}), TimeToWaitForConfirmHasBallBearing, false);
-		}
-		else // We had it before, now we don't
-		{
-			GetWorldTimerManager().ClearTimer(ConfirmHasBallBearingTimerHandle);
-
-			bHasBallBearing = false;
-
-			bPotentialHasBallBearing = false;
-
-			HandleHasBallBearingVfX();
-		}
+		// We don't set has ball bearing true without waiting, remember when the wait started
+		bPotentialHasBallBearing = true;
+		PotentialHasBallBearingStartTime = now;
+		return;
 	}
+
+	// We had it before, now we don't
+	bHasBallBearing = false;
+
+	bPotentialHasBallBearing = false;
+
+	HandleHasBallBearingVfX();
+	NotifyGameModeHasBallBearingChanged();
+}
+
+void ABallBearingGoal::NotifyGameModeHasBallBearingChanged() const
+{
+	if (!GameMode)return;
+
+	GameMode->BallBearingGoalChanged(bHasBallBearing);
 }
 
 void ABallBearingGoal::NotifyActorBeginOverlap(AActor* OtherActor)
@@ -136,7 +161,11 @@ void ABallBearingGoal::NotifyActorBeginOverlap(AActor* OtherActor)
 		return;
 	}
 
-	BallBearings.AddUnique(enteringBallBearing);
+	// First ball bearing in range, get magnetism and checks from the subsystem
+	if (BallBearings.Add(enteringBallBearing) && BallBearings.Num() == 1)
+	{
+		SetAwake(true);
+	}
 }
 
 void ABallBearingGoal::NotifyActorEndOverlap(AActor* OtherActor)
@@ -150,7 +179,24 @@ void ABallBearingGoal::NotifyActorEndOverlap(AActor* OtherActor)
 		return;
 	}
 
-	BallBearings.Remove(exitingBallBearing);
+	if (BallBearings.Remove(exitingBallBearing) && BallBearings.IsEmpty())
+	{
+		GoToSleep();
+	}
+}
+
+bool ABallBearingGoal::PruneBallBearings()
+{
+	return BallBearings.Prune() && BallBearings.IsEmpty();
+}
+
+void ABallBearingGoal::GoToSleep()
+{
+	// Last ball bearing left, settle our state before the subsystem stops checking us. There is nothing left to confirm
+	bPotentialHasBallBearing = false;
+	UpdateHasBallBearing(false, GetWorld()->GetTimeSeconds());
+
+	SetAwake(false);
 }
 
 ABallBearing* ABallBearingGoal::IsBallBearingAndMagnetized(AActor* OtherActor) const
@@ -163,11 +209,33 @@ ABallBearing* ABallBearingGoal::IsBallBearingAndMagnetized(AActor* OtherActor) c
 	return nullptr;
 }
 
-void ABallBearingGoal::HandleHasBallBearingVfX() const
+void ABallBearingGoal::HandleHasBallBearingVfX()
+{
+	if (!GoalSubsystem)return;
+
+	GoalSubsystem->RequestVfxUpdate(this);
+}
+
+bool ABallBearingGoal::UpdateVfx(const double now)
 {
+	// Goals spawned from code have no vfx
+	if (!NormalFireVfx || !HasBallBearingFireVfx)return true;
+
+	// Already showing it, the state flapped back before we switched
+	if (bVfxApplied && bVfxShowsHasBallBearing == bHasBallBearing)return true;
+
+	if (bVfxApplied && now - LastVfxChangeTime < MinVfxDwellTime)return false;
+
 	const auto deActivatedPs = bHasBallBearing ? NormalFireVfx : HasBallBearingFireVfx;
 	deActivatedPs->Deactivate();
 
+	// Don't reset, an already active system keeps simulating
 	const auto activatedPs = bHasBallBearing ? HasBallBearingFireVfx : NormalFireVfx;
-	activatedPs->Activate(true);
+	activatedPs->Activate(false);
+
+	bVfxApplied = true;
+	bVfxShowsHasBallBearing = bHasBallBearing;
+	LastVfxChangeTime = now;
+
+	return true;
 }
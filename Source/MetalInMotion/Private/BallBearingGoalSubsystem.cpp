@@ -0,0 +1,417 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingGoalSubsystem.h"
+
+#include "BallBearing.h"
+#include "BallBearingGoal.h"
+#include "BallBearingMagnetismSimCallback.h"
+#include "EngineUtils.h"
+#include "PBDRigidsSolver.h"
+#include "Components/SphereComponent.h"
+#include "Async/ParallelFor.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ball Bearing Magnetism"), STAT_BallBearingMagnetism, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Ball Bearing Goal Checks"), STAT_BallBearingGoalChecks, STATGROUP_Game);
+
+static TAutoConsoleVariable<int32> CVarParallelMagnetism(
+	TEXT("MetalInMotion.ParallelMagnetism"),
+	1,
+	TEXT("Compute goal magnetism on task graph workers. Results are the same either way. \n")
+	TEXT(" 0: game thread only \n")
+	TEXT(" 1: parallel when there is enough work \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarParallelMagnetismMinBatchSize(
+	TEXT("MetalInMotion.ParallelMagnetismMinBatchSize"),
+	256,
+	TEXT("Least pairs or bearings a worker gets when computing goal magnetism in parallel. \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarAsyncMagnetism(
+	TEXT("MetalInMotion.AsyncMagnetism"),
+	0,
+	TEXT("Apply goal magnetism on the physics thread, using physics thread positions, instead of on the game thread. \n")
+	TEXT(" 0: game thread \n")
+	TEXT(" 1: physics thread \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMagnetismField(
+	TEXT("MetalInMotion.MagnetismField"),
+	0,
+	TEXT("Sample goal magnetism from a grid baked from every goal instead of computing it per goal and bearing. \n")
+	TEXT(" Only for levels whose goals don't move. \n")
+	TEXT(" 0: per goal and bearing \n")
+	TEXT(" 1: baked field \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarMagnetismFieldCellSize(
+	TEXT("MetalInMotion.MagnetismFieldCellSize"),
+	25.0f,
+	TEXT("Distance between the samples of the baked goal magnetism field, changing it rebakes the field. \n"),
+	ECVF_Default);
+
+void UBallBearingGoalSubsystem::Register(ABallBearingGoal* ballBearingGoal)
+{
+	Goals.AddUnique(ballBearingGoal);
+}
+
+void UBallBearingGoalSubsystem::Unregister(ABallBearingGoal* ballBearingGoal)
+{
+	Goals.RemoveSwap(ballBearingGoal);
+}
+
+void UBallBearingGoalSubsystem::RequestVfxUpdate(ABallBearingGoal* ballBearingGoal)
+{
+	PendingVfxGoals.AddUnique(ballBearingGoal);
+}
+
+void UBallBearingGoalSubsystem::CancelVfxUpdate(ABallBearingGoal* ballBearingGoal)
+{
+	PendingVfxGoals.RemoveSwap(ballBearingGoal);
+}
+
+bool UBallBearingGoalSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBallBearingGoalSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (FPhysScene* physicsScene = InWorld.GetPhysicsScene())
+	{
+		MagnetismSimCallback = physicsScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FBallBearingMagnetismSimCallback>();
+		PhysScenePreTickHandle = physicsScene->OnPhysScenePreTick.AddUObject(this, &UBallBearingGoalSubsystem::OnPhysScenePreTick);
+	}
+}
+
+void UBallBearingGoalSubsystem::Deinitialize()
+{
+	if (FPhysScene* physicsScene = GetWorld()->GetPhysicsScene())
+	{
+		physicsScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+
+		if (MagnetismSimCallback)
+		{
+			physicsScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(MagnetismSimCallback);
+		}
+	}
+
+	MagnetismSimCallback = nullptr;
+
+	Super::Deinitialize();
+}
+
+TStatId UBallBearingGoalSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBallBearingGoalSubsystem, STATGROUP_Tickables);
+}
+
+void UBallBearingGoalSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	UpdateGoalVfx();
+}
+
+void UBallBearingGoalSubsystem::OnPhysScenePreTick(FPhysScene_Chaos* physicsScene, float deltaSeconds)
+{
+	if (Goals.IsEmpty())return;
+
+	PruneGoals();
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BallBearingMagnetism);
+		LastMagnetismSeconds = 0.0;
+		FScopedDurationTimer magnetismTimer(LastMagnetismSeconds);
+
+		GatherMagnetism();
+
+		if (MagnetismSimCallback && (CVarAsyncMagnetism.GetValueOnGameThread() != 0 || bAsyncMagnetismActive))
+		{
+			PushAsyncMagnetism();
+		}
+		else if (!PairForces.IsEmpty())
+		{
+			if (CVarMagnetismField.GetValueOnGameThread() != 0)
+			{
+				SampleMagnetismField();
+			}
+			else
+			{
+				BuildBearingPairLists();
+
+				ComputeMagnetismForces();
+			}
+
+			ApplyMagnetismForces();
+		}
+	}
+
+	CheckGoals();
+}
+
+void UBallBearingGoalSubsystem::UpdateGoalVfx()
+{
+	if (PendingVfxGoals.IsEmpty())return;
+
+	const double now = GetWorld()->GetTimeSeconds();
+
+	for (int i = PendingVfxGoals.Num() - 1; i >= 0; --i)
+	{
+		if (PendingVfxGoals[i]->UpdateVfx(now))
+		{
+			PendingVfxGoals.RemoveAtSwap(i, 1, false);
+		}
+	}
+}
+
+void UBallBearingGoalSubsystem::PruneGoals()
+{
+	// Goals left without ball bearings unregister themselves, so collect them first
+	TArray<ABallBearingGoal*, TInlineAllocator<16>> emptiedGoals;
+
+	for (ABallBearingGoal* goal : Goals)
+	{
+		if (goal->PruneBallBearings())
+		{
+			emptiedGoals.Add(goal);
+		}
+	}
+
+	for (ABallBearingGoal* goal : emptiedGoals)
+	{
+		goal->GoToSleep();
+	}
+}
+
+void UBallBearingGoalSubsystem::CheckGoals()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallBearingGoalChecks);
+	LastGoalCheckSeconds = 0.0;
+	FScopedDurationTimer goalCheckTimer(LastGoalCheckSeconds);
+
+	// Confirmation waits compare against the start time, no timers involved
+	const double now = GetWorld()->GetTimeSeconds();
+
+	LastCheckedGoalCount = 0;
+
+	for (int goalIndex = 0; goalIndex < Goals.Num(); ++goalIndex)
+	{
+		ABallBearingGoal* goal = Goals[goalIndex];
+		if (now < goal->NextCheckTime)continue;
+
+		const FVector goalLocation = GoalLocations[goalIndex];
+		const float maxDistanceSquared = goal->MaxDistanceToHasBallBearingSquared;
+		const float maxSpeedSquared = goal->LessThanVelSizeToHasBallBearingSquared;
+
+		// Does any of the ball bearings in range meet conditions for has ball bearing ? Branch free so the loop vectorizes
+		bool bMeetsConditions = false;
+		for (int i = GoalPairOffsets[goalIndex]; i < GoalPairOffsets[goalIndex + 1]; ++i)
+		{
+			const int32 bearingIndex = PairBearingIndices[i];
+			bMeetsConditions |= (FVector::DistSquared(goalLocation, BearingLocations[bearingIndex]) <= maxDistanceSquared) & (BearingSpeedsSquared[bearingIndex] <= maxSpeedSquared);
+		}
+
+		goal->UpdateHasBallBearing(bMeetsConditions, now);
+		goal->UpdateNextCheckTime(bMeetsConditions, now);
+
+		++LastCheckedGoalCount;
+	}
+}
+
+void UBallBearingGoalSubsystem::GatherMagnetism()
+{
+	if (!ExtraMagnetismCVar)
+	{
+		ExtraMagnetismCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("MetalInMotion.ExtraMagnetism"));
+	}
+
+	// If we're cheating then give our goals extra magnetism.
+	const float magnetismMultiplier = ExtraMagnetismCVar && ExtraMagnetismCVar->GetInt() != 0 ? 4.0f : 1.0f;
+
+	GoalLocations.Reset(Goals.Num());
+	GoalRadii.Reset(Goals.Num());
+	GoalMagnetisms.Reset(Goals.Num());
+	GoalPairOffsets.Reset(Goals.Num() + 1);
+	Bearings.Reset();
+	BearingLocations.Reset();
+	BearingSpeedsSquared.Reset();
+	BearingIndices.Reset();
+	PairGoalIndices.Reset();
+	PairBearingIndices.Reset();
+
+	const double now = GetWorld()->GetTimeSeconds();
+
+	// Pruned goals all have ball bearings, every goal gets an index matching Goals for the checks
+	for (const ABallBearingGoal* goal : Goals)
+	{
+		GoalPairOffsets.Add(PairGoalIndices.Num());
+
+		const int32 goalIndex = GoalLocations.Add(goal->GetActorLocation());
+		GoalRadii.Add(Cast<USphereComponent>(goal->GetCollisionComponent())->GetScaledSphereRadius());
+		GoalMagnetisms.Add(goal->Magnetism * magnetismMultiplier);
+
+		// Resting goals get no pairs, their bearings aren't pulled or checked until the goal's next check
+		if (now < goal->NextCheckTime)continue;
+
+		for (int i = 0; i < goal->BallBearings.Num(); ++i)
+		{
+			PairGoalIndices.Add(goalIndex);
+			PairBearingIndices.Add(FindOrAddBearing(goal->BallBearings[i]));
+		}
+	}
+
+	GoalPairOffsets.Add(PairGoalIndices.Num());
+
+	PairForces.SetNumUninitialized(PairGoalIndices.Num(), false);
+}
+
+int32 UBallBearingGoalSubsystem::FindOrAddBearing(const ABallBearing* ballBearing)
+{
+	if (const int32* foundIndex = BearingIndices.Find(ballBearing))
+	{
+		return *foundIndex;
+	}
+
+	// Location and velocity are read once per bearing per frame, for magnetism and the goal checks
+	const int32 bearingIndex = Bearings.Add(ballBearing);
+	BearingLocations.Add(ballBearing->GetActorLocation());
+	BearingSpeedsSquared.Add(ballBearing->BallMesh->GetPhysicsLinearVelocity().SizeSquared());
+	BearingIndices.Add(ballBearing, bearingIndex);
+
+	return bearingIndex;
+}
+
+void UBallBearingGoalSubsystem::PushAsyncMagnetism()
+{
+	FBallBearingMagnetismAsyncInput* input = MagnetismSimCallback->GetProducerInputData_External();
+	input->Reset();
+
+	// Switched back to the game thread, the empty input stops the physics thread from applying the last one
+	bAsyncMagnetismActive = CVarAsyncMagnetism.GetValueOnGameThread() != 0;
+	if (!bAsyncMagnetismActive)return;
+
+	input->GoalLocations = GoalLocations;
+	input->GoalRadii = GoalRadii;
+	input->GoalMagnetisms = GoalMagnetisms;
+	input->PairGoalIndices = PairGoalIndices;
+
+	input->PairBearingProxies.Reserve(PairBearingIndices.Num());
+	for (const int32 bearingIndex : PairBearingIndices)
+	{
+		input->PairBearingProxies.Add(Bearings[bearingIndex]->BallMesh->GetBodyInstance()->GetPhysicsActorHandle());
+	}
+}
+
+void UBallBearingGoalSubsystem::BuildBearingPairLists()
+{
+	// Counting sort of the pairs by bearing, stable so pairs keep their order within a bearing
+	BearingPairOffsets.Reset(Bearings.Num() + 1);
+	BearingPairOffsets.AddZeroed(Bearings.Num() + 1);
+
+	for (const int32 bearingIndex : PairBearingIndices)
+	{
+		++BearingPairOffsets[bearingIndex + 1];
+	}
+
+	for (int i = 0; i < Bearings.Num(); ++i)
+	{
+		BearingPairOffsets[i + 1] += BearingPairOffsets[i];
+	}
+
+	BearingPairs.SetNumUninitialized(PairBearingIndices.Num(), false);
+
+	// Offsets are used as write cursors, then shifted back
+	for (int i = 0; i < PairBearingIndices.Num(); ++i)
+	{
+		BearingPairs[BearingPairOffsets[PairBearingIndices[i]]++] = i;
+	}
+
+	for (int i = Bearings.Num(); i > 0; --i)
+	{
+		BearingPairOffsets[i] = BearingPairOffsets[i - 1];
+	}
+	BearingPairOffsets[0] = 0;
+}
+
+void UBallBearingGoalSubsystem::ComputeMagnetismForces()
+{
+	const bool bParallel = CVarParallelMagnetism.GetValueOnGameThread() != 0;
+	const int32 minBatchSize = FMath::Max(CVarParallelMagnetismMinBatchSize.GetValueOnGameThread(), 1);
+	const EParallelForFlags parallelForFlags = bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+
+	// Pull towards the goal center, full magnetism at the center and none at the edge of the goal
+	ParallelFor(TEXT("BallBearingMagnetismPairs"), PairForces.Num(), minBatchSize, [&](const int32 i)
+	{
+		const int32 goalIndex = PairGoalIndices[i];
+
+		const FVector difference = GoalLocations[goalIndex] - BearingLocations[PairBearingIndices[i]];
+		const float distance = difference.Size();
+		const FVector direction = difference.GetSafeNormal();
+
+		const float ratio = distance / GoalRadii[goalIndex];
+		PairForces[i] = (1.0f - ratio) * GoalMagnetisms[goalIndex] * direction;
+	}, parallelForFlags);
+
+	BearingForces.SetNumUninitialized(Bearings.Num(), false);
+
+	// Every bearing sums its own pairs in pair order, so the result doesn't depend on how work was split
+	ParallelFor(TEXT("BallBearingMagnetismSums"), Bearings.Num(), minBatchSize, [&](const int32 bearingIndex)
+	{
+		FVector force = FVector::ZeroVector;
+
+		for (int k = BearingPairOffsets[bearingIndex]; k < BearingPairOffsets[bearingIndex + 1]; ++k)
+		{
+			force += PairForces[BearingPairs[k]];
+		}
+
+		BearingForces[bearingIndex] = force;
+	}, parallelForFlags);
+}
+
+void UBallBearingGoalSubsystem::BakeMagnetismField()
+{
+	MagnetismField.Reset(CVarMagnetismFieldCellSize.GetValueOnGameThread());
+
+	for (TActorIterator<ABallBearingGoal> it(GetWorld()); it; ++it)
+	{
+		const ABallBearingGoal* goal = *it;
+		if (!goal->HasActorBegunPlay() || goal->IsActorBeingDestroyed())continue;
+
+		MagnetismField.AddGoal(goal->GetActorLocation(), Cast<USphereComponent>(goal->GetCollisionComponent())->GetScaledSphereRadius(), goal->Magnetism);
+	}
+
+	bMagnetismFieldDirty = false;
+}
+
+void UBallBearingGoalSubsystem::SampleMagnetismField()
+{
+	if (bMagnetismFieldDirty || MagnetismField.GetCellSize() != FMath::Max(CVarMagnetismFieldCellSize.GetValueOnGameThread(), 1.0f))
+	{
+		BakeMagnetismField();
+	}
+
+	// Cheat multiplier is applied here so toggling it doesn't need a rebake
+	const float magnetismMultiplier = ExtraMagnetismCVar && ExtraMagnetismCVar->GetInt() != 0 ? 4.0f : 1.0f;
+
+	BearingForces.SetNumUninitialized(Bearings.Num(), false);
+
+	for (int i = 0; i < Bearings.Num(); ++i)
+	{
+		BearingForces[i] = MagnetismField.Sample(BearingLocations[i]) * magnetismMultiplier;
+	}
+}
+
+void UBallBearingGoalSubsystem::ApplyMagnetismForces()
+{
+	// Physics writes stay on the game thread
+	for (int i = 0; i < Bearings.Num(); ++i)
+	{
+		Bearings[i]->BallMesh->AddForce(BearingForces[i]);
+	}
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingGroundCheckSubsystem.h"
+
+static TAutoConsoleVariable<int32> CVarAsyncGroundCheck(
+	TEXT("MetalInMotion.AsyncGroundCheck"),
+	0,
+	TEXT("Sweep ball bearing ground checks as async scene queries, results are used a frame later. \n")
+	TEXT(" 0: synchronous sweep when needed \n")
+	TEXT(" 1: async sweeps batched once per frame \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarAsyncGroundCheckInterval(
+	TEXT("MetalInMotion.AsyncGroundCheckInterval"),
+	1,
+	TEXT("Frames between async ground sweeps of a ball bearing, bearings are spread over the frames. \n")
+	TEXT(" Higher values mean fewer sweeps and older results. \n"),
+	ECVF_Default);
+
+bool UBallBearingGroundCheckSubsystem::IsEnabled()
+{
+	return CVarAsyncGroundCheck.GetValueOnGameThread() != 0;
+}
+
+bool UBallBearingGroundCheckSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UBallBearingGroundCheckSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBallBearingGroundCheckSubsystem, STATGROUP_Tickables);
+}
+
+void UBallBearingGroundCheckSubsystem::RequestSweep(const AActor* bearing, const FVector& start, const FVector& end, float radius, ECollisionChannel traceChannel)
+{
+	FGroundSweep* sweep = Sweeps.Find(bearing);
+	if (!sweep)
+	{
+		sweep = &Sweeps.Add(bearing);
+		sweep->Stagger = NextStagger++;
+	}
+
+	sweep->Start = start;
+	sweep->End = end;
+	sweep->Radius = radius;
+	sweep->TraceChannel = traceChannel;
+	sweep->bRequested = true;
+}
+
+const FHitResult* UBallBearingGroundCheckSubsystem::FindLatestHit(const AActor* bearing) const
+{
+	const FGroundSweep* sweep = Sweeps.Find(bearing);
+	if (!sweep || !sweep->bHasHit)return nullptr;
+
+	// A result from before the bearing's last turn to sweep is too old to trust
+	const uint64 interval = FMath::Max(CVarAsyncGroundCheckInterval.GetValueOnGameThread(), 1);
+	if (GFrameCounter - sweep->HitFrame > interval + 1)return nullptr;
+
+	return &sweep->Hit;
+}
+
+void UBallBearingGroundCheckSubsystem::Unregister(const AActor* bearing)
+{
+	Sweeps.Remove(bearing);
+}
+
+void UBallBearingGroundCheckSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const uint32 interval = FMath::Max(CVarAsyncGroundCheckInterval.GetValueOnGameThread(), 1);
+
+	for (auto it = Sweeps.CreateIterator(); it; ++it)
+	{
+		const AActor* bearing = it->Key.Get();
+		if (!bearing)
+		{
+			it.RemoveCurrent();
+			continue;
+		}
+
+		FGroundSweep& sweep = it->Value;
+		if (!sweep.bRequested || (GFrameCounter + sweep.Stagger) % interval != 0)continue;
+
+		static const FName groundSweepName(TEXT("BallBearingAsyncGroundSweep"));
+		const FCollisionQueryParams queryParams(groundSweepName, true, bearing);
+		const FTraceDelegate onSweepDone = FTraceDelegate::CreateUObject(this, &UBallBearingGroundCheckSubsystem::OnSweepDone, it->Key);
+
+		GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Single, sweep.Start, sweep.End, FQuat::Identity, sweep.TraceChannel, FCollisionShape::MakeSphere(sweep.Radius), queryParams,
+		                                FCollisionResponseParams::DefaultResponseParam, &onSweepDone);
+
+		sweep.bRequested = false;
+		sweep.IssuedFrame = GFrameCounter;
+	}
+}
+
+void UBallBearingGroundCheckSubsystem::OnSweepDone(const FTraceHandle& traceHandle, FTraceDatum& traceDatum, TWeakObjectPtr<const AActor> bearing)
+{
+	// Bearing may have unregistered while the sweep was running
+	FGroundSweep* sweep = Sweeps.Find(bearing);
+	if (!sweep)return;
+
+	sweep->bHasHit = true;
+	sweep->HitFrame = sweep->IssuedFrame;
+	sweep->Hit = traceDatum.OutHits.IsEmpty() ? FHitResult() : traceDatum.OutHits[0];
+}
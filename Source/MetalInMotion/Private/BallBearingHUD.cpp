@@ -3,19 +3,86 @@
 
 #include "BallBearingHUD.h"
 #include "PlayerBallBearing.h"
+#include "MetalInMotion/Pool/Pooler.h"
+#include "MetalInMotion/Pool/PoolerSubsystem.h"
+
+static TAutoConsoleVariable<int32> CVarShowPoolStats(
+	TEXT("MetalInMotion.ShowPoolStats"),
+	0,
+	TEXT("Show pooler occupancy and churn on the HUD. \n")
+	TEXT(" 0: hidden \n")
+	TEXT(" 1: shown \n"),
+	ECVF_Cheat);
 
 void ABallBearingHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
+	if (CVarShowPoolStats.GetValueOnGameThread() != 0)
+	{
+		DrawPoolStats();
+	}
+	else if (!PoolRateSamples.IsEmpty())
+	{
+		PoolRateSamples.Empty();
+	}
+
 	const APlayerBallBearing* ballBearing = Cast<APlayerBallBearing>(GetOwningPawn());
 
 	if (!ballBearing)return;
 
 	AddFloat(L"Speed", ballBearing->GetVelocity().Size() / 100.0f);
-	AddFloat(L"Input Latitude", ballBearing->InputVector.Y);
-	AddFloat(L"Input Longitude", ballBearing->InputVector.X);
+	AddFloat(L"Input Latitude", ballBearing->GetInputVector().Y);
+	AddFloat(L"Input Longitude", ballBearing->GetInputVector().X);
 	AddBool(L"Is Grounded", ballBearing->IsGrounded());
-	AddBool(L"Can Dash", ballBearing->bCanDash);
-	AddText(L"Player Ball Bearing State", FText::FromString(UEnum::GetValueAsName(ballBearing->CurrentPlayerBallBearingState).ToString()));
+	AddFloat(L"Time Since Grounded", ballBearing->GetTimeSinceGrounded());
+	AddBool(L"Can Dash", ballBearing->CanDash());
+	AddText(L"Player Ball Bearing State", FText::FromString(UEnum::GetValueAsName(ballBearing->GetPlayerBallBearingState()).ToString()));
+}
+
+void ABallBearingHUD::DrawPoolStats()
+{
+	const UPoolerSubsystem* poolerSubsystem = GetWorld()->GetSubsystem<UPoolerSubsystem>();
+	if (!poolerSubsystem)return;
+
+	// Rates are measured over windows of a second so they are readable
+	const double now = GetWorld()->GetRealTimeSeconds();
+	const double windowSeconds = now - PoolRateWindowStart;
+	const bool bWindowEnded = windowSeconds >= 1.0;
+
+	for (const TPair<FGameplayTag, TObjectPtr<APooler>>& poolerPair : poolerSubsystem->GetPoolers())
+	{
+		const APooler* pooler = poolerPair.Value;
+		if (!IsValid(pooler))continue;
+
+		const FPoolStats& stats = pooler->GetStats();
+
+		FPoolRateSample* rateSample = PoolRateSamples.Find(pooler);
+		if (!rateSample)
+		{
+			rateSample = &PoolRateSamples.Add(pooler, {stats.AcquireCount, stats.ReleaseCount});
+		}
+		else if (bWindowEnded)
+		{
+			rateSample->AcquiresPerSecond = (stats.AcquireCount - rateSample->AcquireCount) / windowSeconds;
+			rateSample->ReleasesPerSecond = (stats.ReleaseCount - rateSample->ReleaseCount) / windowSeconds;
+			rateSample->AcquireCount = stats.AcquireCount;
+			rateSample->ReleaseCount = stats.ReleaseCount;
+		}
+
+		const int32 inUse = pooler->GetInUseCount();
+		const FText value = FText::FromString(FString::Printf(TEXT("cap %d  used %d  free %d  peak %d  acq/s %.1f  rel/s %.1f  exhausted %lld"),
+			pooler->GetCapacity(), inUse, pooler->GetCapacity() - inUse, stats.PeakInUse,
+			rateSample->AcquiresPerSecond, rateSample->ReleasesPerSecond, stats.ExhaustedCount));
+
+		// Red while empty, orange if it ran out before
+		const FLinearColor valueColor = inUse == pooler->GetCapacity() ? FLinearColor::Red : stats.ExhaustedCount > 0 ? FLinearColor(1.0f, 0.5f, 0.0f) : FLinearColor::White;
+
+		AddText(*poolerPair.Key.GetTagName().ToString(), value, valueColor);
+	}
+
+	if (bWindowEnded)
+	{
+		PoolRateWindowStart = now;
+	}
 }
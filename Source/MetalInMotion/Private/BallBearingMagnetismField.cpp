@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingMagnetismField.h"
+
+void FBallBearingMagnetismField::Reset(float cellSize)
+{
+	BrickIndices.Reset();
+	Samples.Reset();
+
+	CellSize = FMath::Max(cellSize, 1.0f);
+}
+
+void FBallBearingMagnetismField::AddGoal(const FVector& location, float radius, float magnetism)
+{
+	if (radius <= 0.0f)return;
+
+	const FVector minCorner = (location - FVector(radius)) / CellSize;
+	const FVector maxCorner = (location + FVector(radius)) / CellSize;
+
+	for (int32 z = FMath::FloorToInt32(minCorner.Z); z <= FMath::CeilToInt32(maxCorner.Z); ++z)
+	{
+		for (int32 y = FMath::FloorToInt32(minCorner.Y); y <= FMath::CeilToInt32(maxCorner.Y); ++y)
+		{
+			for (int32 x = FMath::FloorToInt32(minCorner.X); x <= FMath::CeilToInt32(maxCorner.X); ++x)
+			{
+				const FVector difference = location - FVector(x, y, z) * CellSize;
+				const float distance = difference.Size();
+				if (distance >= radius)continue;
+
+				// Same falloff the goal subsystem uses per goal and bearing pair
+				const float ratio = distance / radius;
+				FindOrAddCorner(FIntVector(x, y, z)) += FVector3f((1.0f - ratio) * magnetism * difference.GetSafeNormal());
+			}
+		}
+	}
+}
+
+FVector FBallBearingMagnetismField::Sample(const FVector& location) const
+{
+	const FVector gridLocation = location / CellSize;
+	const FIntVector base(FMath::FloorToInt32(gridLocation.X), FMath::FloorToInt32(gridLocation.Y), FMath::FloorToInt32(gridLocation.Z));
+	const FVector3f alpha(gridLocation - FVector(base));
+
+	// Interpolate along X, then Y, then Z
+	FVector3f alongX[4];
+	for (int i = 0; i < 4; ++i)
+	{
+		const FIntVector corner = base + FIntVector(0, i & 1, i >> 1);
+		alongX[i] = FMath::Lerp(GetCorner(corner), GetCorner(corner + FIntVector(1, 0, 0)), alpha.X);
+	}
+
+	const FVector3f bottom = FMath::Lerp(alongX[0], alongX[1], alpha.Y);
+	const FVector3f top = FMath::Lerp(alongX[2], alongX[3], alpha.Y);
+
+	return FVector(FMath::Lerp(bottom, top, alpha.Z));
+}
+
+FVector3f FBallBearingMagnetismField::GetCorner(const FIntVector& corner) const
+{
+	const int32* brickIndex = BrickIndices.Find(GetBrickCoordinate(corner));
+	return brickIndex ? Samples[*brickIndex + GetSampleIndex(corner)] : FVector3f::ZeroVector;
+}
+
+FVector3f& FBallBearingMagnetismField::FindOrAddCorner(const FIntVector& corner)
+{
+	const FIntVector brickCoordinate = GetBrickCoordinate(corner);
+
+	const int32* brickIndex = BrickIndices.Find(brickCoordinate);
+	if (!brickIndex)
+	{
+		const int32 newBrickIndex = Samples.AddZeroed(BrickSampleCount);
+		brickIndex = &BrickIndices.Add(brickCoordinate, newBrickIndex);
+	}
+
+	return Samples[*brickIndex + GetSampleIndex(corner)];
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingMagnetismSimCallback.h"
+
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+void FBallBearingMagnetismSimCallback::OnPreSimulate_Internal()
+{
+	// Proxies are only alive for the step their input is consumed in, steps without new input apply nothing
+	const FBallBearingMagnetismAsyncInput* input = GetConsumerInput_Internal();
+	if (!input)return;
+
+	// Pull towards the goal center, full magnetism at the center and none at the edge of the goal
+	for (int i = 0; i < input->PairGoalIndices.Num(); ++i)
+	{
+		FSingleParticlePhysicsProxy* bearingProxy = input->PairBearingProxies[i];
+
+		// Bearing may have been destroyed since the input was sent
+		if (!bearingProxy || bearingProxy->GetMarkedDeleted())continue;
+
+		Chaos::FRigidBodyHandle_Internal* bearingBody = bearingProxy->GetPhysicsThreadAPI();
+		if (!bearingBody)continue;
+
+		const int32 goalIndex = input->PairGoalIndices[i];
+
+		const FVector difference = input->GoalLocations[goalIndex] - bearingBody->X();
+		const float distance = difference.Size();
+		const FVector direction = difference.GetSafeNormal();
+
+		const float ratio = distance / input->GoalRadii[goalIndex];
+		bearingBody->AddForce((1.0f - ratio) * input->GoalMagnetisms[goalIndex] * direction);
+	}
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingMovementSimCallback.h"
+
+#include "MetalInMotion/BlueprintFunctionLibraries/Public/InterpolationLibrary.h"
+#include "PhysicsProxy/SingleParticlePhysicsProxy.h"
+
+void FBallBearingMovementSimCallback::OnPreSimulate_Internal()
+{
+	// Proxies are only alive for the step their input is consumed in, steps without new input apply nothing
+	const FBallBearingMovementAsyncInput* input = GetConsumerInput_Internal();
+	if (!input)return;
+
+	// Forget the spring state of bearings that stopped moving with us
+	TSet<uint32, DefaultKeyFuncs<uint32>, TInlineSetAllocator<16>> bearingIds;
+	for (const FBallBearingMovementInput& bearing : input->Bearings)
+	{
+		bearingIds.Add(bearing.BearingId);
+	}
+
+	for (auto it = ClampSpringVelocities.CreateIterator(); it; ++it)
+	{
+		if (!bearingIds.Contains(it->Key))
+		{
+			it.RemoveCurrent();
+		}
+	}
+
+	const float deltaSeconds = GetDeltaTime_Internal();
+
+	for (const FBallBearingMovementInput& bearing : input->Bearings)
+	{
+		// Bearing may have been destroyed since the input was sent
+		if (!bearing.Proxy || bearing.Proxy->GetMarkedDeleted())continue;
+
+		Chaos::FRigidBodyHandle_Internal* body = bearing.Proxy->GetPhysicsThreadAPI();
+		if (!body)continue;
+
+		if (bearing.bHasMoveInput)
+		{
+			if (body->ObjectState() == Chaos::EObjectStateType::Sleeping)
+			{
+				body->SetObjectState(Chaos::EObjectStateType::Dynamic);
+			}
+
+			body->AddForce(bearing.InputVector * bearing.ControllerForce * body->M());
+
+			if (bearing.bInAir)
+			{
+				// Changing incoming input vector to left handed rotation direction
+				const FVector wantedAngularVelocityInDeg = FVector(-bearing.InputVector.Y, bearing.InputVector.X, 0.0f) * bearing.InAirAngularVelocity;
+
+				// We don't want to instantly change our angular velocity, it looks bad
+				const FVector angularVelocityInDeg = FMath::VInterpTo(FMath::RadiansToDegrees(FVector(body->W())), wantedAngularVelocityInDeg, deltaSeconds, bearing.InAirToAngularVelocitySpeed);
+				body->SetW(FMath::DegreesToRadians(angularVelocityInDeg));
+			}
+		}
+
+		if (!bearing.bClampSpeed)continue;
+
+		const FVector oldVelocity = body->V();
+		if (FVector(oldVelocity.X, oldVelocity.Y, 0.0f).Size() <= bearing.MaximumSpeed)continue;
+
+		FVector velocity = oldVelocity.GetSafeNormal() * bearing.MaximumSpeed;
+		// doing this because ball bearing loses jumping force if jumped after dashing.
+		velocity.Z = oldVelocity.Z;
+
+		FVector& springVelocity = ClampSpringVelocities.FindOrAdd(bearing.BearingId, FVector::ZeroVector);
+		body->SetV(UInterpolationLibrary::VectorSpringInterpCD(oldVelocity, velocity, springVelocity, deltaSeconds, bearing.ClampToMaxSpeedInterpSpeed));
+	}
+}
@@ -0,0 +1,509 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingMovementSubsystem.h"
+
+#include "BallBearingGroundCheckSubsystem.h"
+#include "BallBearingMovementSimCallback.h"
+#include "PBDRigidsSolver.h"
+#include "Async/ParallelFor.h"
+#include "MetalInMotion/BlueprintFunctionLibraries/Public/InterpolationLibrary.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ball Bearing Movement"), STAT_BallBearingMovement, STATGROUP_Game);
+
+static TAutoConsoleVariable<int32> CVarAsyncMovement(
+	TEXT("MetalInMotion.AsyncMovement"),
+	0,
+	TEXT("Apply player ball bearing input force, in air steering and speed clamp on the physics thread, using physics thread velocities. \n")
+	TEXT(" 0: game thread, once per frame \n")
+	TEXT(" 1: physics thread, on the step that takes the frame's input \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarContactGroundDetection(
+	TEXT("MetalInMotion.ContactGroundDetection"),
+	1,
+	TEXT("How ball bearings detect ground. \n")
+	TEXT(" 0: sphere trace every frame \n")
+	TEXT(" 1: from hit contacts, sphere trace only when contacts stop while grounded \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarParallelMovement(
+	TEXT("MetalInMotion.ParallelMovement"),
+	1,
+	TEXT("Compute ball bearing movement on task graph workers. Results are the same either way. \n")
+	TEXT(" 0: game thread only \n")
+	TEXT(" 1: parallel when there is enough work \n"),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarParallelMovementMinBatchSize(
+	TEXT("MetalInMotion.ParallelMovementMinBatchSize"),
+	64,
+	TEXT("Least bearings a worker gets when computing ball bearing movement in parallel. \n"),
+	ECVF_Default);
+
+int32 UBallBearingMovementSubsystem::Register(ABallBearing* ballBearing, const FBallBearingMovementParams& movementParams)
+{
+	const int32 movementIndex = Owners.Add(ballBearing);
+	BearingIds.Add(NextBearingId++);
+	Bodies.Add(ballBearing->BallMesh);
+	Proxies.Add(nullptr);
+	Params.Add(movementParams);
+	InputVectors.Add(FVector::ZeroVector);
+	States.Add(InAir);
+	ClampSpringVelocities.Add(FVector::ZeroVector);
+	DashEndTimes.Add(0.0);
+	DashReadyTimes.Add(0.0);
+	HasMoveInput.Add(false);
+	JumpPressTimes.Add(-1.0);
+	DashPressTimes.Add(-1.0);
+	LastJumpTimes.Add(-1.0);
+	GroundedFlags.Add(false);
+	LastGroundedTimes.Add(0.0);
+	GroundContacts.Add(false);
+
+	return movementIndex;
+}
+
+void UBallBearingMovementSubsystem::Unregister(int32 movementIndex)
+{
+	if (!Owners.IsValidIndex(movementIndex))return;
+
+	if (GroundCheckSubsystem)
+	{
+		GroundCheckSubsystem->Unregister(Owners[movementIndex]);
+	}
+
+	Owners.RemoveAtSwap(movementIndex, 1, false);
+	BearingIds.RemoveAtSwap(movementIndex, 1, false);
+	Bodies.RemoveAtSwap(movementIndex, 1, false);
+	Proxies.RemoveAtSwap(movementIndex, 1, false);
+	Params.RemoveAtSwap(movementIndex, 1, false);
+	InputVectors.RemoveAtSwap(movementIndex, 1, false);
+	States.RemoveAtSwap(movementIndex, 1, false);
+	ClampSpringVelocities.RemoveAtSwap(movementIndex, 1, false);
+	DashEndTimes.RemoveAtSwap(movementIndex, 1, false);
+	DashReadyTimes.RemoveAtSwap(movementIndex, 1, false);
+	HasMoveInput.RemoveAtSwap(movementIndex, 1, false);
+	JumpPressTimes.RemoveAtSwap(movementIndex, 1, false);
+	DashPressTimes.RemoveAtSwap(movementIndex, 1, false);
+	LastJumpTimes.RemoveAtSwap(movementIndex, 1, false);
+	GroundedFlags.RemoveAtSwap(movementIndex, 1, false);
+	LastGroundedTimes.RemoveAtSwap(movementIndex, 1, false);
+	GroundContacts.RemoveAtSwap(movementIndex, 1, false);
+
+	// The last bearing moved into the freed index
+	if (Owners.IsValidIndex(movementIndex))
+	{
+		Owners[movementIndex]->MovementIndex = movementIndex;
+	}
+}
+
+void UBallBearingMovementSubsystem::NotifyHit(int32 movementIndex, const FVector& hitNormal)
+{
+	if (CVarContactGroundDetection.GetValueOnGameThread() == 0 || hitNormal.Z < Params[movementIndex].MinGroundNormalZ)return;
+
+	// Rolling reports many hits per frame, any of them keeps us grounded
+	GroundedFlags[movementIndex] = true;
+	LastGroundedTimes[movementIndex] = GetWorld()->GetTimeSeconds();
+	GroundContacts[movementIndex] = true;
+}
+
+void UBallBearingMovementSubsystem::SetMoveInput(int32 movementIndex, const FVector& inputVector)
+{
+	InputVectors[movementIndex] = inputVector;
+	HasMoveInput[movementIndex] = true;
+}
+
+void UBallBearingMovementSubsystem::RequestJump(int32 movementIndex)
+{
+	JumpPressTimes[movementIndex] = GetWorld()->GetTimeSeconds();
+}
+
+void UBallBearingMovementSubsystem::RequestDash(int32 movementIndex)
+{
+	DashPressTimes[movementIndex] = GetWorld()->GetTimeSeconds();
+}
+
+bool UBallBearingMovementSubsystem::Dash(int32 movementIndex)
+{
+	// only dash if cooldown is over
+	if (!GetCanDash(movementIndex))return false;
+
+	const FBallBearingMovementParams& params = Params[movementIndex];
+
+	const double now = GetWorld()->GetTimeSeconds();
+	DashEndTimes[movementIndex] = now + params.DashTime;
+	DashReadyTimes[movementIndex] = now + params.DashCoolDown;
+
+	// change ball bearing state so velocity does not get clamped at max speed
+	States[movementIndex] = Dashing;
+
+	UPrimitiveComponent* body = Bodies[movementIndex];
+
+	auto dashDirection = InputVectors[movementIndex];
+
+	// if there is no input
+	if (dashDirection.Size() == 0)
+	{
+		auto noInputDashDirection = body->GetPhysicsLinearVelocity();
+		noInputDashDirection.Z = 0;
+
+		// if ball is barely or not moving in X-Y
+		if (noInputDashDirection.Size() <= 1.0f)
+		{
+			// if there is no input and ball is barely moving, use forward of the actor
+			noInputDashDirection = Owners[movementIndex]->GetActorForwardVector();
+		}
+		else
+		{
+			noInputDashDirection.Normalize();
+		}
+
+		dashDirection = noInputDashDirection;
+	}
+	dashDirection.Z = 0;
+
+	// zero out normal velocity because we dont want dash velocity effected by normal velocity
+	body->SetPhysicsLinearVelocity(FVector::ZeroVector);
+	body->AddImpulse(dashDirection * params.DashImpulse);
+
+	// first zero out angular velocity and add a angular impulse towards the way we are dashing
+	body->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
+	body->AddAngularImpulseInDegrees(FVector(-dashDirection.Y, dashDirection.X, 0.0f) * params.DashAngularImpulse);
+
+	Owners[movementIndex]->OnDashed();
+
+	return true;
+}
+
+bool UBallBearingMovementSubsystem::IsAsyncMovementActive() const
+{
+	return MovementSimCallback && CVarAsyncMovement.GetValueOnGameThread() != 0;
+}
+
+bool UBallBearingMovementSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBallBearingMovementSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	GroundCheckSubsystem = InWorld.GetSubsystem<UBallBearingGroundCheckSubsystem>();
+
+	if (FPhysScene* physicsScene = InWorld.GetPhysicsScene())
+	{
+		MovementSimCallback = physicsScene->GetSolver()->CreateAndRegisterSimCallbackObject_External<FBallBearingMovementSimCallback>();
+		PhysScenePreTickHandle = physicsScene->OnPhysScenePreTick.AddUObject(this, &UBallBearingMovementSubsystem::OnPhysScenePreTick);
+	}
+}
+
+void UBallBearingMovementSubsystem::Deinitialize()
+{
+	if (FPhysScene* physicsScene = GetWorld()->GetPhysicsScene())
+	{
+		physicsScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+
+		if (MovementSimCallback)
+		{
+			physicsScene->GetSolver()->UnregisterAndFreeSimCallbackObject_External(MovementSimCallback);
+		}
+	}
+
+	MovementSimCallback = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UBallBearingMovementSubsystem::OnPhysScenePreTick(FPhysScene_Chaos* physicsScene, float deltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BallBearingMovement);
+	LastMovementSeconds = 0.0;
+	FScopedDurationTimer movementTimer(LastMovementSeconds);
+
+	GatherBearings();
+
+	ConsumeBufferedInput();
+
+	// Switched back to the game thread, one empty input stops the physics thread from applying the last one
+	const bool bWasAsyncMovementActive = bAsyncMovementActive;
+	bAsyncMovementActive = IsAsyncMovementActive();
+
+	if (bAsyncMovementActive || bWasAsyncMovementActive)
+	{
+		PushAsyncMovement();
+	}
+
+	ComputeMovement(deltaSeconds);
+
+	ApplyMovement();
+
+	// Input of this frame is used up
+	FMemory::Memzero(HasMoveInput.GetData(), HasMoveInput.Num());
+}
+
+void UBallBearingMovementSubsystem::GatherBearings()
+{
+	const int32 bearingCount = Owners.Num();
+
+	Velocities.SetNumUninitialized(bearingCount, false);
+	AngularVelocitiesInDeg.SetNumUninitialized(bearingCount, false);
+	Masses.SetNumUninitialized(bearingCount, false);
+
+	const double now = GetWorld()->GetTimeSeconds();
+	const bool bContactGroundDetection = CVarContactGroundDetection.GetValueOnGameThread() != 0;
+
+	// Physics state and grounded are read once per bearing per frame
+	for (int i = 0; i < bearingCount; ++i)
+	{
+		const UPrimitiveComponent* body = Bodies[i];
+		Proxies[i] = body->GetBodyInstance()->GetPhysicsActorHandle();
+		Velocities[i] = body->GetPhysicsLinearVelocity();
+		AngularVelocitiesInDeg[i] = body->GetPhysicsAngularVelocityInDegrees();
+		Masses[i] = body->GetMass();
+
+		const bool bHadGroundContact = GroundContacts[i] != 0;
+		GroundContacts[i] = false;
+
+		if (!bContactGroundDetection)
+		{
+			TraceGround(i, now);
+		}
+		// Hits made us grounded already, and landing always reports a hit so we can't become grounded without one
+		else if (!bHadGroundContact && GroundedFlags[i])
+		{
+			// Sleeping bodies report no hits but stay where they are
+			if (!body->RigidBodyIsAwake())
+			{
+				LastGroundedTimes[i] = now;
+			}
+			// Grounded but contacts stopped, we may have rolled off an edge or be resting without new hits
+			else
+			{
+				TraceGround(i, now);
+			}
+		}
+
+		if (States[i] == Dashing && now >= DashEndTimes[i])
+		{
+			States[i] = GroundedFlags[i] ? Grounded : InAir;
+		}
+		else if (!GroundedFlags[i])
+		{
+			SetState(i, InAir);
+		}
+	}
+}
+
+void UBallBearingMovementSubsystem::TraceGround(int32 movementIndex, double now)
+{
+	const FBallBearingMovementParams& params = Params[movementIndex];
+	const ABallBearing* ballBearing = Owners[movementIndex];
+
+	// set start and end of the trace
+	const FVector startTrace = Bodies[movementIndex]->GetComponentLocation();
+	const FVector endTrace = FVector(startTrace.X, startTrace.Y, startTrace.Z - params.GroundTraceDistance);
+
+	if (GroundCheckSubsystem && UBallBearingGroundCheckSubsystem::IsEnabled())
+	{
+		// Result of an earlier frame's sweep, keep our state until the first one arrives
+		GroundCheckSubsystem->RequestSweep(ballBearing, startTrace, endTrace, params.GroundTraceRadius, params.GroundTraceChannel);
+
+		if (const FHitResult* hit = GroundCheckSubsystem->FindLatestHit(ballBearing))
+		{
+			ApplyGroundHit(movementIndex, *hit, now);
+		}
+
+		return;
+	}
+
+	// trace from center of the bearing to down, ignoring the bearing
+	static const FName groundTraceName(TEXT("BallBearingGroundTrace"));
+	const FCollisionQueryParams queryParams(groundTraceName, true, ballBearing);
+
+	FHitResult hit;
+	GetWorld()->SweepSingleByChannel(hit, startTrace, endTrace, FQuat::Identity, params.GroundTraceChannel, FCollisionShape::MakeSphere(params.GroundTraceRadius), queryParams);
+
+	ApplyGroundHit(movementIndex, hit, now);
+}
+
+void UBallBearingMovementSubsystem::ApplyGroundHit(int32 movementIndex, const FHitResult& hit, double now)
+{
+	// grounded if trace hit something and its a actor
+	GroundedFlags[movementIndex] = hit.bBlockingHit && IsValid(hit.GetActor());
+
+	if (!GroundedFlags[movementIndex])return;
+
+	LastGroundedTimes[movementIndex] = now;
+}
+
+void UBallBearingMovementSubsystem::ConsumeBufferedInput()
+{
+	const double now = GetWorld()->GetTimeSeconds();
+
+	Jumps.Reset();
+	Jumps.AddZeroed(Owners.Num());
+
+	for (int i = 0; i < Owners.Num(); ++i)
+	{
+		const FBallBearingMovementParams& params = Params[i];
+
+		if (DashPressTimes[i] >= 0.0)
+		{
+			if (now - DashPressTimes[i] > params.DashBufferTime)
+			{
+				DashPressTimes[i] = -1.0;
+			}
+			else if (Dash(i))
+			{
+				DashPressTimes[i] = -1.0;
+
+				// Dash reset the body's velocities, writes below must start from that and not from what was gathered
+				Velocities[i] = Bodies[i]->GetPhysicsLinearVelocity();
+				AngularVelocitiesInDeg[i] = Bodies[i]->GetPhysicsAngularVelocityInDegrees();
+			}
+		}
+
+		if (JumpPressTimes[i] < 0.0)continue;
+
+		// Only jump if there is a contact which usually the ground, or was a moment ago and we didn't jump off it
+		const bool bCoyote = now - LastGroundedTimes[i] <= params.CoyoteTime && LastJumpTimes[i] < LastGroundedTimes[i];
+		if (GroundedFlags[i] || bCoyote)
+		{
+			Jumps[i] = true;
+			LastJumpTimes[i] = now;
+			JumpPressTimes[i] = -1.0;
+		}
+		else if (now - JumpPressTimes[i] > params.JumpBufferTime)
+		{
+			JumpPressTimes[i] = -1.0;
+		}
+	}
+}
+
+void UBallBearingMovementSubsystem::ComputeMovement(float deltaSeconds)
+{
+	const int32 bearingCount = Owners.Num();
+
+	Forces.SetNumUninitialized(bearingCount, false);
+	NewVelocities.SetNumUninitialized(bearingCount, false);
+	NewAngularVelocitiesInDeg.SetNumUninitialized(bearingCount, false);
+	Writes.SetNumUninitialized(bearingCount, false);
+
+	const bool bParallel = CVarParallelMovement.GetValueOnGameThread() != 0;
+	const int32 minBatchSize = FMath::Max(CVarParallelMovementMinBatchSize.GetValueOnGameThread(), 1);
+
+	// Only jumps are left to us while the physics thread moves the bearings
+	const bool bJumpsOnly = bAsyncMovementActive;
+
+	ParallelFor(TEXT("BallBearingMovement"), bearingCount, minBatchSize, [&](const int32 i)
+	{
+		const FBallBearingMovementParams& params = Params[i];
+		const FVector& inputVector = InputVectors[i];
+
+		Forces[i] = FVector::ZeroVector;
+		Writes[i] = 0;
+
+		FVector velocity = Velocities[i];
+
+		if (!bJumpsOnly && HasMoveInput[i])
+		{
+			Forces[i] = inputVector * params.ControllerForce * Masses[i];
+
+			if (States[i] == InAir)
+			{
+				// Changing incoming input vector to left handed rotation direction
+				const FVector changedInputVectorToRotationBasedDirection = FVector(-inputVector.Y, inputVector.X, 0);
+
+				// We don't want to instantly change our angular velocity, it looks bad
+				NewAngularVelocitiesInDeg[i] = FMath::VInterpTo(AngularVelocitiesInDeg[i], changedInputVectorToRotationBasedDirection * params.InAirAngularVelocity, deltaSeconds,
+				                                                params.InAirToAngularVelocitySpeed);
+				Writes[i] |= WriteAngularVelocity;
+			}
+		}
+
+		if (!bJumpsOnly && States[i] != Dashing && FVector(velocity.X, velocity.Y, 0.0f).Size() > params.MaximumSpeed)
+		{
+			FVector clampedVelocity = velocity.GetSafeNormal() * params.MaximumSpeed;
+			// doing this because ball bearing loses jumping force if jumped after dashing.
+			clampedVelocity.Z = velocity.Z;
+
+			velocity = UInterpolationLibrary::VectorSpringInterpCD(velocity, clampedVelocity, ClampSpringVelocities[i], deltaSeconds, params.ClampToMaxSpeedInterpSpeed);
+			Writes[i] |= WriteVelocity;
+		}
+
+		if (Jumps[i])
+		{
+			// Zero out upwards velocity so jumping is consistent
+			velocity.Z = 0.0f;
+			Writes[i] |= WriteVelocity | WriteJumpImpulse;
+		}
+
+		NewVelocities[i] = velocity;
+	}, bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+}
+
+void UBallBearingMovementSubsystem::ApplyMovement()
+{
+	// Physics writes stay on the game thread
+	for (int i = 0; i < Owners.Num(); ++i)
+	{
+		UPrimitiveComponent* body = Bodies[i];
+
+		if (!Forces[i].IsZero())
+		{
+			body->AddForce(Forces[i]);
+		}
+
+		const uint8 writes = Writes[i];
+		if (writes == 0)continue;
+
+		if (writes & WriteAngularVelocity)
+		{
+			body->SetPhysicsAngularVelocityInDegrees(NewAngularVelocitiesInDeg[i]);
+		}
+
+		if (writes & WriteVelocity)
+		{
+			body->SetPhysicsLinearVelocity(NewVelocities[i]);
+		}
+
+		if (writes & WriteJumpImpulse)
+		{
+			body->AddImpulse(FVector::UpVector * Params[i].JumpImpulse);
+		}
+	}
+}
+
+void UBallBearingMovementSubsystem::PushAsyncMovement()
+{
+	FBallBearingMovementAsyncInput* input = MovementSimCallback->GetProducerInputData_External();
+	input->Reset();
+
+	if (!bAsyncMovementActive)return;
+
+	input->Bearings.SetNum(Owners.Num());
+	for (int i = 0; i < Owners.Num(); ++i)
+	{
+		const FBallBearingMovementParams& params = Params[i];
+		FBallBearingMovementInput& bearingInput = input->Bearings[i];
+
+		bearingInput.Proxy = Proxies[i];
+		bearingInput.BearingId = BearingIds[i];
+
+		bearingInput.InputVector = InputVectors[i];
+		bearingInput.bHasMoveInput = HasMoveInput[i] != 0;
+		bearingInput.ControllerForce = params.ControllerForce;
+
+		bearingInput.MaximumSpeed = params.MaximumSpeed;
+		bearingInput.ClampToMaxSpeedInterpSpeed = params.ClampToMaxSpeedInterpSpeed;
+		bearingInput.bClampSpeed = States[i] != Dashing;
+
+		bearingInput.InAirAngularVelocity = params.InAirAngularVelocity;
+		bearingInput.InAirToAngularVelocitySpeed = params.InAirToAngularVelocitySpeed;
+		bearingInput.bInAir = States[i] == InAir;
+	}
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingOverlapSet.h"
+
+#include "BallBearing.h"
+
+bool FBallBearingOverlapSet::Add(ABallBearing* ballBearing)
+{
+	const TWeakObjectPtr<ABallBearing> weakBallBearing(ballBearing);
+
+	if (Indices.Contains(weakBallBearing))return false;
+
+	Indices.Add(weakBallBearing, Items.Add(weakBallBearing));
+
+	return true;
+}
+
+bool FBallBearingOverlapSet::Remove(ABallBearing* ballBearing)
+{
+	const int32* foundIndex = Indices.Find(TWeakObjectPtr<ABallBearing>(ballBearing));
+
+	if (!foundIndex)return false;
+
+	RemoveAtSwap(*foundIndex);
+
+	return true;
+}
+
+bool FBallBearingOverlapSet::Prune()
+{
+	bool bAnyDropped = false;
+
+	// Backwards so swapped in items were already visited
+	for (int i = Items.Num() - 1; i >= 0; --i)
+	{
+		// Pooled ball bearings are hidden in their pool
+		if (const ABallBearing* ballBearing = Items[i].Get(); ballBearing && !ballBearing->IsHidden())continue;
+
+		RemoveAtSwap(i);
+		bAnyDropped = true;
+	}
+
+	return bAnyDropped;
+}
+
+void FBallBearingOverlapSet::RemoveAtSwap(int32 index)
+{
+	Indices.Remove(Items[index]);
+
+	Items.RemoveAtSwap(index, 1, false);
+
+	// The last item moved into the hole
+	if (Items.IsValidIndex(index))
+	{
+		Indices[Items[index]] = index;
+	}
+}
@@ -0,0 +1,393 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BallBearingGoalSubsystem.h"
+#include "BallBearingMovementSubsystem.h"
+#include "InputActionValue.h"
+#include "PlayerBallBearing.h"
+#include "StressUtilities.h"
+#include "Containers/Ticker.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "MetalInMotion/Pool/PoolableComponent.h"
+#include "MetalInMotion/Pool/Pooler.h"
+#include "MetalInMotion/Pool/PoolerSubsystem.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "RenderCore.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace PerfHarness
+{
+	// Frames run before measuring so spawning, overlaps and pool setup settle
+	constexpr int32 WarmUpFrameCount = 30;
+
+	// Seconds a churned pooled actor stays out of its pool
+	constexpr float ChurnLifetime = 0.5f;
+
+	// Frames between jump presses of a moving bearing, bearings are spread over them
+	constexpr int32 MovingBearingJumpInterval = 90;
+
+	// Per frame measurements, all in milliseconds but memory
+	struct FFrame
+	{
+		float FrameMs = 0.0f;
+		float GameThreadMs = 0.0f;
+		float MagnetismMs = 0.0f;
+		float GoalChecksMs = 0.0f;
+		float MovementMs = 0.0f;
+		float PoolerTickMs = 0.0f;
+		float PhysicsMs = 0.0f;
+		float GarbageCollectionMs = 0.0f;
+		float UsedPhysicalMB = 0.0f;
+	};
+
+	// State of a running measurement, kept alive by the ticker driving it
+	struct FRun
+	{
+		TWeakObjectPtr<UWorld> World;
+		TArray<TWeakObjectPtr<AActor>> SpawnedActors;
+		TArray<TWeakObjectPtr<APooler>> Poolers;
+		TArray<TWeakObjectPtr<APlayerBallBearing>> MovingBearings;
+
+		int32 GoalCount = 0;
+		int32 BearingCount = 0;
+		int32 PoolerCount = 0;
+		int32 PoolSize = 0;
+		int32 FrameCount = 0;
+		int32 MovingBearingCount = 0;
+
+		// Negative while warming up, runs one past FrameCount to fill in the last frame's game thread time
+		int32 Frame = -WarmUpFrameCount;
+
+		TArray<FFrame> Frames;
+
+		double LastFrameSeconds = 0.0;
+
+		// Physics and garbage collection time of the current frame, filled by the delegates below
+		double PhysicsStartSeconds = 0.0;
+		double PhysicsSeconds = 0.0;
+		double GarbageCollectionStartSeconds = 0.0;
+		double GarbageCollectionSeconds = 0.0;
+		int32 GarbageCollectionCount = 0;
+
+		FDelegateHandle PhysScenePreTickHandle;
+		FDelegateHandle PhysScenePostTickHandle;
+		FDelegateHandle PreGarbageCollectHandle;
+		FDelegateHandle PostGarbageCollectHandle;
+
+		// Hook the physics scene and garbage collection
+		void Start();
+
+		// Take and send back pooled actors so poolers have lifetimes to tick
+		void ChurnPoolers() const;
+
+		// Steer moving bearings in circles and press jump now and then, so the movement pass has input to handle
+		void DriveMovingBearings() const;
+
+		// Record this frame's measurements, returns false when done
+		bool Tick();
+
+		// Remove the delegates hooked in Start
+		void Unhook();
+
+		// Unhook, write the reports and clean up
+		void Finish();
+
+		// Full garbage collection time with everything spawned, averaged over a few collections
+		double MeasureFullGarbageCollectionMs() const;
+
+		// Per frame csv and summary json in Saved/Profiling/MetalInMotion
+		void WriteReports(double fullGarbageCollectionMs) const;
+	};
+
+	// Average and max of a frame field
+	void Summarize(const TArray<FFrame>& frames, float FFrame::* field, float& outAverage, float& outMax)
+	{
+		float total = 0.0f;
+		outMax = 0.0f;
+
+		for (const FFrame& frame : frames)
+		{
+			total += frame.*field;
+			outMax = FMath::Max(outMax, frame.*field);
+		}
+
+		outAverage = frames.IsEmpty() ? 0.0f : total / frames.Num();
+	}
+}
+
+void PerfHarness::FRun::Start()
+{
+	FPhysScene* physicsScene = World->GetPhysicsScene();
+
+	PhysScenePreTickHandle = physicsScene->OnPhysScenePreTick.AddLambda([this](FPhysScene_Chaos*, float)
+	{
+		PhysicsStartSeconds = FPlatformTime::Seconds();
+	});
+
+	// From the pre tick to the post tick covers the solver's step and waiting on it
+	PhysScenePostTickHandle = physicsScene->OnPhysScenePostTick.AddLambda([this](FChaosScene*)
+	{
+		PhysicsSeconds += FPlatformTime::Seconds() - PhysicsStartSeconds;
+	});
+
+	PreGarbageCollectHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddLambda([this]
+	{
+		GarbageCollectionStartSeconds = FPlatformTime::Seconds();
+	});
+
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddLambda([this]
+	{
+		GarbageCollectionSeconds += FPlatformTime::Seconds() - GarbageCollectionStartSeconds;
+		++GarbageCollectionCount;
+	});
+
+	Frames.Reserve(FrameCount);
+	LastFrameSeconds = FPlatformTime::Seconds();
+}
+
+void PerfHarness::FRun::ChurnPoolers() const
+{
+	// About half of every pool is out at a time at 60 fps
+	const int32 churnPerFrame = FMath::Max(PoolSize / 60, 1);
+
+	for (const TWeakObjectPtr<APooler>& pooler : Poolers)
+	{
+		if (!pooler.IsValid())continue;
+
+		for (int i = 0; i < churnPerFrame && pooler->GetInUseCount() < pooler->GetCapacity(); ++i)
+		{
+			const AActor* pooledActor = pooler->GetPooledObj();
+			if (!pooledActor)break;
+
+			pooledActor->FindComponentByClass<UPoolableComponent>()->SetLifetime(ChurnLifetime);
+		}
+	}
+}
+
+void PerfHarness::FRun::DriveMovingBearings() const
+{
+	for (int i = 0; i < MovingBearings.Num(); ++i)
+	{
+		APlayerBallBearing* ballBearing = MovingBearings[i].Get();
+		if (!ballBearing)continue;
+
+		// Every bearing turns a full circle every two seconds at 60 fps, starting at its own angle
+		const float angle = (Frame + i) * UE_TWO_PI / 120.0f;
+		ballBearing->Move(FInputActionValue(FVector(FMath::Cos(angle), FMath::Sin(angle), 0.0f)));
+
+		if ((Frame + i) % MovingBearingJumpInterval == 0)
+		{
+			ballBearing->Jump();
+		}
+	}
+}
+
+bool PerfHarness::FRun::Tick()
+{
+	if (!World.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("perf harness world went away, no report written"));
+		Unhook();
+		return false;
+	}
+
+	const double now = FPlatformTime::Seconds();
+
+	// Game thread time is published when a frame is drawn, so what we read now belongs to the frame recorded last tick
+	if (Frame > 0)
+	{
+		Frames.Last().GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	}
+
+	if (Frame >= FrameCount)
+	{
+		Finish();
+		return false;
+	}
+
+	UPoolerSubsystem* poolerSubsystem = World->GetSubsystem<UPoolerSubsystem>();
+
+	if (Frame >= 0)
+	{
+		const UBallBearingGoalSubsystem* goalSubsystem = World->GetSubsystem<UBallBearingGoalSubsystem>();
+		const UBallBearingMovementSubsystem* movementSubsystem = World->GetSubsystem<UBallBearingMovementSubsystem>();
+
+		FFrame& frame = Frames.AddDefaulted_GetRef();
+		frame.FrameMs = (now - LastFrameSeconds) * 1000.0;
+		frame.MagnetismMs = goalSubsystem ? goalSubsystem->GetLastMagnetismSeconds() * 1000.0 : 0.0;
+		frame.GoalChecksMs = goalSubsystem ? goalSubsystem->GetLastGoalCheckSeconds() * 1000.0 : 0.0;
+		frame.MovementMs = movementSubsystem ? movementSubsystem->GetLastMovementSeconds() * 1000.0 : 0.0;
+		frame.PoolerTickMs = poolerSubsystem ? poolerSubsystem->GetTickSeconds() * 1000.0 : 0.0;
+		frame.PhysicsMs = PhysicsSeconds * 1000.0;
+		frame.GarbageCollectionMs = GarbageCollectionSeconds * 1000.0;
+		frame.UsedPhysicalMB = FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0);
+	}
+
+	LastFrameSeconds = now;
+	PhysicsSeconds = 0.0;
+	GarbageCollectionSeconds = 0.0;
+
+	if (poolerSubsystem)
+	{
+		poolerSubsystem->ResetTickSeconds();
+	}
+
+	++Frame;
+
+	ChurnPoolers();
+
+	DriveMovingBearings();
+
+	return true;
+}
+
+void PerfHarness::FRun::Unhook()
+{
+	// The physics scene goes away with its world
+	if (FPhysScene* physicsScene = World.IsValid() ? World->GetPhysicsScene() : nullptr)
+	{
+		physicsScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+		physicsScene->OnPhysScenePostTick.Remove(PhysScenePostTickHandle);
+	}
+
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+}
+
+void PerfHarness::FRun::Finish()
+{
+	Unhook();
+
+	WriteReports(MeasureFullGarbageCollectionMs());
+
+	StressUtilities::DestroySpawned(SpawnedActors);
+
+	if (FApp::IsUnattended())
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+double PerfHarness::FRun::MeasureFullGarbageCollectionMs() const
+{
+	constexpr int32 collectionCount = 5;
+
+	double totalSeconds = 0.0;
+	for (int i = 0; i < collectionCount; ++i)
+	{
+		const double startSeconds = FPlatformTime::Seconds();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+		totalSeconds += FPlatformTime::Seconds() - startSeconds;
+	}
+
+	return totalSeconds * 1000.0 / collectionCount;
+}
+
+void PerfHarness::FRun::WriteReports(double fullGarbageCollectionMs) const
+{
+	const FString reportDirectory = FPaths::ProjectSavedDir() / TEXT("Profiling") / TEXT("MetalInMotion");
+	const FString reportName = FString::Printf(TEXT("Perf_%dg_%db_%dm_%dp_%s"), GoalCount, BearingCount, MovingBearingCount, PoolerCount, *FDateTime::Now().ToString());
+
+	TArray<FString> lines;
+	lines.Reserve(Frames.Num() + 1);
+	lines.Add(TEXT("frame,frameMs,gameThreadMs,magnetismMs,goalChecksMs,movementMs,poolerTickMs,physicsMs,gcMs,usedPhysicalMB"));
+
+	for (int i = 0; i < Frames.Num(); ++i)
+	{
+		const FFrame& frame = Frames[i];
+		lines.Add(FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f"), i, frame.FrameMs, frame.GameThreadMs, frame.MagnetismMs,
+			frame.GoalChecksMs, frame.MovementMs, frame.PoolerTickMs, frame.PhysicsMs, frame.GarbageCollectionMs, frame.UsedPhysicalMB));
+	}
+
+	FFileHelper::SaveStringArrayToFile(lines, *(reportDirectory / reportName + TEXT(".csv")));
+
+	// Summary of every column as "name": {"avg": x, "max": y}
+	const TPair<const TCHAR*, float FFrame::*> columns[] = {
+		{TEXT("frameMs"), &FFrame::FrameMs},
+		{TEXT("gameThreadMs"), &FFrame::GameThreadMs},
+		{TEXT("magnetismMs"), &FFrame::MagnetismMs},
+		{TEXT("goalChecksMs"), &FFrame::GoalChecksMs},
+		{TEXT("movementMs"), &FFrame::MovementMs},
+		{TEXT("poolerTickMs"), &FFrame::PoolerTickMs},
+		{TEXT("physicsMs"), &FFrame::PhysicsMs},
+		{TEXT("gcMs"), &FFrame::GarbageCollectionMs},
+		{TEXT("usedPhysicalMB"), &FFrame::UsedPhysicalMB}
+	};
+
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\t\"goals\": %d,\n\t\"ballBearings\": %d,\n\t\"movingBallBearings\": %d,\n\t\"poolers\": %d,\n\t\"poolSize\": %d,\n\t\"frames\": %d,\n"),
+		GoalCount, BearingCount, MovingBearingCount, PoolerCount, PoolSize, Frames.Num());
+	json += FString::Printf(TEXT("\t\"gcCount\": %d,\n\t\"fullGcMs\": %.3f,\n\t\"peakUsedPhysicalMB\": %.1f,\n"),
+		GarbageCollectionCount, fullGarbageCollectionMs, FPlatformMemory::GetStats().PeakUsedPhysical / (1024.0 * 1024.0));
+
+	for (int i = 0; i < UE_ARRAY_COUNT(columns); ++i)
+	{
+		float average;
+		float max;
+		Summarize(Frames, columns[i].Value, average, max);
+
+		json += FString::Printf(TEXT("\t\"%s\": {\"avg\": %.3f, \"max\": %.3f}%s\n"), columns[i].Key, average, max, i + 1 < UE_ARRAY_COUNT(columns) ? TEXT(",") : TEXT(""));
+
+		UE_LOG(LogTemp, Display, TEXT("perf %s: %.3f avg, %.3f max"), columns[i].Key, average, max);
+	}
+
+	json += TEXT("}\n");
+
+	FFileHelper::SaveStringToFile(json, *(reportDirectory / reportName + TEXT(".json")));
+
+	UE_LOG(LogTemp, Display, TEXT("perf report of %d frames written to %s"), Frames.Num(), *(reportDirectory / reportName));
+}
+
+// Spawn a stress setup, measure a fixed number of frames and write csv and json reports comparable across commits.
+// Runs headless on a machine without a gpu with: -game -nullrhi -unattended -ExecCmds="MetalInMotion.Perf.Run 1000 5000 20 600 500 200"
+static FAutoConsoleCommandWithWorldAndArgs PerfRunCommand(
+	TEXT("MetalInMotion.Perf.Run"),
+	TEXT("Spawns goals, ball bearings, moving player ball bearings and poolers, measures gameplay, physics, gc and memory cost over some frames and writes a report to Saved/Profiling/MetalInMotion. \n")
+	TEXT(" Quits afterwards when -unattended. \n")
+	TEXT(" Arguments: goal count (default 1000), ball bearing count (default 5000), pooler count (default 20), frame count (default 600), pool size (default 500), \n")
+	TEXT(" moving player ball bearing count (default 200) \n"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if (!world || !world->HasBegunPlay())
+		{
+			UE_LOG(LogTemp, Error, TEXT("perf harness needs a world in play"));
+			return;
+		}
+
+		const TSharedRef<PerfHarness::FRun> run = MakeShared<PerfHarness::FRun>();
+		run->World = world;
+		run->GoalCount = args.IsValidIndex(0) ? FCString::Atoi(*args[0]) : 1000;
+		run->BearingCount = args.IsValidIndex(1) ? FCString::Atoi(*args[1]) : 5000;
+		run->PoolerCount = args.IsValidIndex(2) ? FCString::Atoi(*args[2]) : 20;
+		run->FrameCount = FMath::Max(args.IsValidIndex(3) ? FCString::Atoi(*args[3]) : 600, 1);
+		run->PoolSize = FMath::Max(args.IsValidIndex(4) ? FCString::Atoi(*args[4]) : 500, 1);
+		run->MovingBearingCount = args.IsValidIndex(5) ? FCString::Atoi(*args[5]) : 200;
+
+		TArray<AActor*> spawnedActors;
+		StressUtilities::SpawnGoalField(world, run->GoalCount, run->BearingCount, spawnedActors);
+
+		TArray<APlayerBallBearing*> movingBearings;
+		StressUtilities::SpawnMovingBearings(world, run->MovingBearingCount, spawnedActors, movingBearings);
+		run->MovingBearings = TArray<TWeakObjectPtr<APlayerBallBearing>>(movingBearings);
+
+		const int32 firstPoolerIndex = spawnedActors.Num();
+		StressUtilities::SpawnPoolers(world, run->PoolerCount, run->PoolSize, spawnedActors);
+
+		for (int i = firstPoolerIndex; i < spawnedActors.Num(); ++i)
+		{
+			run->Poolers.Add(CastChecked<APooler>(spawnedActors[i]));
+		}
+
+		run->SpawnedActors = TArray<TWeakObjectPtr<AActor>>(spawnedActors);
+		run->Start();
+
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([run](float)
+		{
+			return run->Tick();
+		}));
+	}));
+
+#endif
@@ -3,144 +3,119 @@
 
 #include "PlayerBallBearing.h"
 #include "BallBearing.h"
+#include "BallBearingMovementSubsystem.h"
 #include "InputActionValue.h"
 #include "Kismet/GameplayStatics.h"
-#include "Kismet/KismetMathLibrary.h"
-#include "MetalInMotion/BlueprintFunctionLibraries/Public/InterpolationLibrary.h"
 #include "Particles/ParticleSystemComponent.h"
 
 APlayerBallBearing::APlayerBallBearing()
 {
 	Magnetized = false;
+
+	// UBallBearingMovementSubsystem moves us
+	PrimaryActorTick.bCanEverTick = false;
 }
 
-void APlayerBallBearing::Move(const FInputActionValue& InputActionValue)
+void APlayerBallBearing::BeginPlay()
 {
-	InputVector = InputActionValue.Get<FVector>();
-	BallMesh->AddForce(InputVector * ControllerForce * 100.0f * BallMesh->GetMass());
+	Super::BeginPlay();
 
-	if (CurrentPlayerBallBearingState == InAir)
+	MovementSubsystem = GetWorld()->GetSubsystem<UBallBearingMovementSubsystem>();
+	if (MovementSubsystem)
 	{
-		// Changing incoming input vector to left handed rotation direction
-		const auto changedInputVectorToRotationBasedDirection = FVector(-InputVector.Y, InputVector.X, 0);
-
-		// We don't want to instantly change our angular velocity, it looks bad
-		const auto interpedAngularVelInDeg = UKismetMathLibrary::VInterpTo(
-			BallMesh->GetPhysicsAngularVelocityInDegrees(),
-			changedInputVectorToRotationBasedDirection * InAirAngularImpulseTowardsInputPower * 100.0f,
-			GetWorld()->GetDeltaSeconds(),
-			InAirToAngularVelocitySpeed);
-
-		// Change ball mesh angular velocity towards wanted angular velocity over time
-		BallMesh->SetPhysicsAngularVelocityInDegrees(interpedAngularVelInDeg);
+		MovementIndex = MovementSubsystem->Register(this, GetMovementParams());
 	}
 }
 
-void APlayerBallBearing::Jump()
+FBallBearingMovementParams APlayerBallBearing::GetMovementParams() const
 {
-	// Only jump if there is a contact which usually the ground.
-	if (!IsGrounded())return;
+	FBallBearingMovementParams movementParams;
+	movementParams.ControllerForce = ControllerForce * 100.0f;
+	movementParams.MaximumSpeed = GetMaximumSpeed();
+	movementParams.ClampToMaxSpeedInterpSpeed = ClampToMaxSpeedInterpSpeed;
+	movementParams.JumpImpulse = JumpForce * 1000.0f;
+	movementParams.InAirAngularVelocity = InAirAngularImpulseTowardsInputPower * 100.0f;
+	movementParams.InAirToAngularVelocitySpeed = InAirToAngularVelocitySpeed;
+	movementParams.DashImpulse = DashForce * 1000.0f;
+	movementParams.DashAngularImpulse = DashAngularImpulsePower * 100000.0f;
+	movementParams.DashTime = DashTime;
+	movementParams.DashCoolDown = DashCoolDown;
+	movementParams.JumpBufferTime = JumpBufferTime;
+	movementParams.DashBufferTime = DashBufferTime;
+	movementParams.CoyoteTime = CoyoteTime;
+	movementParams.GroundTraceDistance = GetActorScale().X + SphereTraceGoDistance;
+	movementParams.GroundTraceRadius = GetActorScale().X * 50.0f * SphereTraceRadiusMultiplier;
+	movementParams.GroundTraceChannel = UEngineTypes::ConvertToCollisionChannel(SphereTraceTypeQuery);
+	movementParams.MinGroundNormalZ = MinGroundNormalZ;
+
+	return movementParams;
+}
 
-	// Zero out upwards velocity so jumping is consistent
-	BallMesh->SetPhysicsLinearVelocity(GetVelocityWithoutZ());
-	// Add impulse upwards for jump
-	BallMesh->AddImpulse(FVector::UpVector * JumpForce * 1000.0f);
+EPlayerBallBearingState APlayerBallBearing::GetPlayerBallBearingState() const
+{
+	return IsMovementRegistered() ? MovementSubsystem->GetState(MovementIndex) : InAir;
 }
 
-void APlayerBallBearing::Dash()
+FVector APlayerBallBearing::GetInputVector() const
 {
-	// only dash if not dashing
-	if (!bCanDash)return;
+	return IsMovementRegistered() ? MovementSubsystem->GetInputVector(MovementIndex) : FVector::ZeroVector;
+}
 
-	bCanDash = false;
+bool APlayerBallBearing::CanDash() const
+{
+	return IsMovementRegistered() && MovementSubsystem->GetCanDash(MovementIndex);
+}
 
-	// change ball bearing state so velocity does not get clamped at max speed
-	ChangeBallBearingState(Dashing);
+bool APlayerBallBearing::IsGrounded() const
+{
+	return IsMovementRegistered() && MovementSubsystem->IsGrounded(MovementIndex);
+}
 
-	auto dashDirection = InputVector;
+float APlayerBallBearing::GetTimeSinceGrounded() const
+{
+	return IsMovementRegistered() ? GetWorld()->GetTimeSeconds() - MovementSubsystem->GetLastGroundedTime(MovementIndex) : 0.0f;
+}
 
-	// if there is no input
-	if (dashDirection.Size() == 0)
-	{
-		auto noInputDashDirection = GetVelocityWithoutZ();
-
-		// if ball is barely or not moving in X-Y
-		if (noInputDashDirection.Size() <= 1.0f)
-		{
-			// if there is no input and ball is barely moving, use forward of the actor
-			noInputDashDirection = GetActorForwardVector();
-		}
-		else
-		{
-			noInputDashDirection.Normalize();
-		}
-
-		dashDirection = noInputDashDirection;
-	}
-	dashDirection.Z = 0;
+void APlayerBallBearing::Move(const FInputActionValue& InputActionValue)
+{
+	if (!IsMovementRegistered())return;
 
-	// zero out normal velocity because we dont want dash velocity effected by normal velocity
-	BallMesh->SetPhysicsLinearVelocity(FVector::ZeroVector);
-	BallMesh->AddImpulse(dashDirection * DashForce * 1000.0f);
+	MovementSubsystem->SetMoveInput(MovementIndex, InputActionValue.Get<FVector>());
+}
 
-	// first zero out angular velocity and add a angular impulse towards the way we are dashing
-	BallMesh->SetPhysicsAngularVelocityInDegrees(FVector::ZeroVector);
-	BallMesh->AddAngularImpulseInDegrees(FVector(-dashDirection.Y, dashDirection.X, 0.0f) * DashAngularImpulsePower * 100000.0f);
+void APlayerBallBearing::Jump()
+{
+	if (!IsMovementRegistered())return;
 
-	// play dash vfx
-	DashVfxComponent->ActivateSystem();
+	MovementSubsystem->RequestJump(MovementIndex);
+}
 
-	// set a timer for dash duration
-	GetWorldTimerManager().SetTimer(DashTimer, FTimerDelegate::CreateLambda([&]
-	{
-		ChangeBallBearingState(IsGrounded() ? Grounded : InAir, true);
-	}), DashTime, false);
+void APlayerBallBearing::Dash()
+{
+	if (!IsMovementRegistered())return;
 
-	// set a timer for dash cooldown
-	GetWorldTimerManager().SetTimer(DashCooldownTimer, FTimerDelegate::CreateLambda([&]
-	{
-		bCanDash = true;
-	}), DashCoolDown, false);
+	MovementSubsystem->RequestDash(MovementIndex);
 }
 
-void APlayerBallBearing::Tick(float deltaSeconds)
+void APlayerBallBearing::OnDashed() const
 {
-	if (CurrentPlayerBallBearingState != Dashing)
+	// play dash vfx
+	if (DashVfxComponent)
 	{
-		if (GetVelocityWithoutZ().Size() > GetMaximumSpeed())
-		{
-			const auto oldVelocity = BallMesh->GetComponentVelocity();
-			auto velocity = oldVelocity;
-			velocity.Normalize();
-			velocity *= GetMaximumSpeed();
-			// doing this because ball bearing loses jumping force if jumped after dashing.
-			velocity.Z = oldVelocity.Z;
-
-			const auto mergedVelocity = UInterpolationLibrary::VectorSpringInterpCD(BallMesh->GetComponentVelocity(), velocity, *DashVelocityPtr, GetWorld()->GetDeltaSeconds(), ClampToMaxSpeedInterpSpeed);
-			BallMesh->SetPhysicsLinearVelocity(mergedVelocity);
-		}
+		DashVfxComponent->ActivateSystem();
 	}
-
-	if (!IsGrounded()) ChangeBallBearingState(InAir);
-
-	Super::Tick(deltaSeconds);
 }
 
-bool APlayerBallBearing::IsGrounded() const
+void APlayerBallBearing::NotifyHit(UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
 {
-	// set start and end of the trace
-	const FVector startTrace = GetActorLocation();
-	const FVector endTrace = FVector(startTrace.X, startTrace.Y, startTrace.Z - (GetActorScale().X + SphereTraceGoDistance));
+	Super::NotifyHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
 
-	// ignore this actor when tracing
-	TArray<AActor*> ignoredActors;
-	ignoredActors.Add(TArray<AActor*>::ElementType(this));
+	if (!IsMovementRegistered())return;
 
-	// trace from center of the actor to down
-	FHitResult hit;
-	UKismetSystemLibrary::SphereTraceSingle(GetWorld(), startTrace, endTrace, GetActorScale().X * 50.0f * SphereTraceRadiusMultiplier, SphereTraceTypeQuery, true, ignoredActors, EDrawDebugTrace::None, hit, true);
-	// DrawDebugLine(GetWorld(), startTrace, endTrace, hit.bBlockingHit ? FColor::Blue : FColor::Red, false, 0.1f, 0, 1.0f);
+	if (IsValid(Other))
+	{
+		MovementSubsystem->NotifyHit(MovementIndex, HitNormal);
+	}
 
-	// return if trace hit something and its a actor
-	return hit.bBlockingHit && IsValid(hit.GetActor());
+	if (IsGrounded())MovementSubsystem->SetState(MovementIndex, Grounded);
 }
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StressUtilities.h"
+
+#include "BallBearing.h"
+#include "BallBearingGoal.h"
+#include "BallBearingGoalSubsystem.h"
+#include "PlayerBallBearing.h"
+#include "Containers/Ticker.h"
+#include "Engine/StaticMeshActor.h"
+#include "MetalInMotion/Pool/Pooler.h"
+
+namespace StressUtilities
+{
+	// Where the stress field is spawned, far from anything in the level
+	const FVector FieldOrigin(0.0f, 0.0f, 100000.0f);
+
+	// Distance between goal centers
+	constexpr float GoalSpacing = 400.0f;
+
+	// Goal scale, trigger spheres are 40 units in radius unscaled
+	constexpr float GoalScale = 3.0f;
+
+	// Where stress poolers keep their actors, below the goal field
+	const FVector PoolerOrigin(0.0f, 0.0f, 90000.0f);
+
+	// Where moving bearings roll around, below the poolers
+	const FVector MovingBearingOrigin(0.0f, 0.0f, 80000.0f);
+
+	// Distance between moving bearings at spawn
+	constexpr float MovingBearingSpacing = 200.0f;
+}
+
+void StressUtilities::SpawnGoalField(UWorld* world, int32 goalCount, int32 bearingCount, TArray<AActor*>& outSpawnedActors)
+{
+	if (goalCount <= 0)return;
+
+	UStaticMesh* sphereMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Sphere.Sphere"));
+	const int32 gridWidth = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(goalCount)));
+
+	TArray<FVector> goalLocations;
+	goalLocations.Reserve(goalCount);
+
+	for (int i = 0; i < goalCount; ++i)
+	{
+		const FVector goalLocation = FieldOrigin + FVector(i % gridWidth, i / gridWidth, 0.0f) * GoalSpacing;
+		const FTransform goalTransform(FQuat::Identity, goalLocation, FVector(GoalScale));
+
+		ABallBearingGoal* goal = world->SpawnActorDeferred<ABallBearingGoal>(ABallBearingGoal::StaticClass(), goalTransform);
+		goal->bCountsForLevelEnd = false;
+		goal->FinishSpawning(goalTransform);
+
+		goalLocations.Add(goalLocation);
+		outSpawnedActors.Add(goal);
+	}
+
+	// Deterministic scatter so runs are comparable
+	FRandomStream randomStream(goalCount * 7919 + bearingCount);
+
+	for (int i = 0; i < bearingCount; ++i)
+	{
+		const FVector bearingLocation = goalLocations[i % goalCount] + randomStream.VRand() * randomStream.FRandRange(0.0f, 40.0f * GoalScale * 0.8f);
+
+		ABallBearing* ballBearing = world->SpawnActor<ABallBearing>(ABallBearing::StaticClass(), bearingLocation, FRotator::ZeroRotator);
+		ballBearing->SetActorScale3D(FVector(0.25f));
+		ballBearing->BallMesh->SetStaticMesh(sphereMesh);
+		ballBearing->BallMesh->SetGenerateOverlapEvents(true);
+		ballBearing->BallMesh->SetEnableGravity(false);
+
+		outSpawnedActors.Add(ballBearing);
+	}
+}
+
+void StressUtilities::SpawnMovingBearings(UWorld* world, int32 bearingCount, TArray<AActor*>& outSpawnedActors, TArray<APlayerBallBearing*>& outBearings)
+{
+	if (bearingCount <= 0)return;
+
+	UStaticMesh* sphereMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Sphere.Sphere"));
+	UStaticMesh* cubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	const int32 gridWidth = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(bearingCount)));
+
+	// Floor with room around the grid to roll on, the cube is 100 units wide
+	const float floorSize = (gridWidth + 4) * MovingBearingSpacing;
+	const FVector floorCenter = MovingBearingOrigin + FVector(gridWidth * MovingBearingSpacing * 0.5f, gridWidth * MovingBearingSpacing * 0.5f, -50.0f);
+
+	const FTransform floorTransform(FQuat::Identity, floorCenter, FVector(floorSize / 100.0f, floorSize / 100.0f, 1.0f));
+
+	// Static mesh actors are static, their mesh can only be set before they register
+	AStaticMeshActor* floor = world->SpawnActorDeferred<AStaticMeshActor>(AStaticMeshActor::StaticClass(), floorTransform);
+	floor->GetStaticMeshComponent()->SetStaticMesh(cubeMesh);
+	floor->FinishSpawning(floorTransform);
+
+	outSpawnedActors.Add(floor);
+
+	for (int i = 0; i < bearingCount; ++i)
+	{
+		const FVector bearingLocation = MovingBearingOrigin + FVector(i % gridWidth + 0.5f, i / gridWidth + 0.5f, 0.0f) * MovingBearingSpacing + FVector(0.0f, 0.0f, 50.0f);
+		const FTransform bearingTransform(FQuat::Identity, bearingLocation);
+
+		// Mesh and hit events are set before BeginPlay registers the bearing with the movement subsystem
+		APlayerBallBearing* ballBearing = world->SpawnActorDeferred<APlayerBallBearing>(APlayerBallBearing::StaticClass(), bearingTransform);
+		ballBearing->BallMesh->SetStaticMesh(sphereMesh);
+		ballBearing->BallMesh->SetNotifyRigidBodyCollision(true);
+		ballBearing->FinishSpawning(bearingTransform);
+
+		outSpawnedActors.Add(ballBearing);
+		outBearings.Add(ballBearing);
+	}
+}
+
+void StressUtilities::SpawnPoolers(UWorld* world, int32 poolerCount, int32 poolSize, TArray<AActor*>& outSpawnedActors)
+{
+	for (int i = 0; i < poolerCount; ++i)
+	{
+		const FTransform poolerTransform(PoolerOrigin + FVector(i * GoalSpacing, 0.0f, 0.0f));
+
+		APooler* pooler = world->SpawnActorDeferred<APooler>(APooler::StaticClass(), poolerTransform);
+		pooler->ActorToPool = AStaticMeshActor::StaticClass();
+		pooler->SpawnAtStart = poolSize;
+		pooler->FinishSpawning(poolerTransform);
+
+		outSpawnedActors.Add(pooler);
+	}
+}
+
+void StressUtilities::DestroySpawned(const TArray<TWeakObjectPtr<AActor>>& spawnedActors)
+{
+	for (const TWeakObjectPtr<AActor>& spawnedActor : spawnedActors)
+	{
+		if (spawnedActor.IsValid())
+		{
+			spawnedActor->Destroy();
+		}
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+
+// Spawn a goal field, log the magnetism pass cost over some frames and clean up
+static FAutoConsoleCommandWithWorldAndArgs StressMagnetismCommand(
+	TEXT("MetalInMotion.Goals.StressMagnetism"),
+	TEXT("Spawns goals and ball bearings high above the level, logs the goal magnetism cost per frame and checks that goals resting on a confirmed ball bearing are checked less. \n")
+	TEXT(" Arguments: goal count (default 1000), ball bearing count (default 5000), frame count (default 300) \n"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& args, UWorld* world)
+	{
+		if (!world || !world->HasBegunPlay())
+		{
+			UE_LOG(LogTemp, Error, TEXT("magnetism stress test needs a world in play"));
+			return;
+		}
+
+		const int32 goalCount = args.IsValidIndex(0) ? FCString::Atoi(*args[0]) : 1000;
+		const int32 bearingCount = args.IsValidIndex(1) ? FCString::Atoi(*args[1]) : 5000;
+		const int32 frameCount = FMath::Max(args.IsValidIndex(2) ? FCString::Atoi(*args[2]) : 300, 1);
+
+		TArray<AActor*> spawnedActors;
+		StressUtilities::SpawnGoalField(world, goalCount, bearingCount, spawnedActors);
+
+		const TArray<TWeakObjectPtr<AActor>> weakSpawnedActors(spawnedActors);
+		const TWeakObjectPtr<UWorld> weakWorld(world);
+
+		// Checked goals are compared between the first and the last tenth of the run
+		const int32 windowFrameCount = FMath::Max(frameCount / 10, 1);
+
+		// Sample the magnetism pass once per frame, the first frame is skipped because overlaps aren't in yet
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+			[weakWorld, weakSpawnedActors, goalCount, bearingCount, frameCount, windowFrameCount, frame = -1, totalSeconds = 0.0, maxSeconds = 0.0,
+				firstCheckedGoals = 0, lastCheckedGoals = 0](float) mutable
+			{
+				const UBallBearingGoalSubsystem* goalSubsystem = weakWorld.IsValid() ? weakWorld->GetSubsystem<UBallBearingGoalSubsystem>() : nullptr;
+				if (!goalSubsystem)return false;
+
+				if (++frame > 0)
+				{
+					totalSeconds += goalSubsystem->GetLastMagnetismSeconds();
+					maxSeconds = FMath::Max(maxSeconds, goalSubsystem->GetLastMagnetismSeconds());
+
+					if (frame <= windowFrameCount)
+					{
+						firstCheckedGoals += goalSubsystem->GetLastCheckedGoalCount();
+					}
+
+					if (frame > frameCount - windowFrameCount)
+					{
+						lastCheckedGoals += goalSubsystem->GetLastCheckedGoalCount();
+					}
+				}
+
+				if (frame < frameCount)return true;
+
+				UE_LOG(LogTemp, Display, TEXT("magnetism with %d goals and %d ball bearings: %.3f ms average, %.3f ms max over %d frames"),
+					goalCount, bearingCount, totalSeconds * 1000.0 / frameCount, maxSeconds * 1000.0, frameCount);
+
+				int32 confirmedGoalCount = 0;
+				for (const TWeakObjectPtr<AActor>& spawnedActor : weakSpawnedActors)
+				{
+					const ABallBearingGoal* goal = Cast<ABallBearingGoal>(spawnedActor.Get());
+					confirmedGoalCount += goal && goal->HasBallBearing();
+				}
+
+				UE_LOG(LogTemp, Display, TEXT("goal checks: %.1f goals per frame over the first %d frames, %.1f over the last, %d of %d goals confirmed, %d awake"),
+					static_cast<float>(firstCheckedGoals) / windowFrameCount, windowFrameCount, static_cast<float>(lastCheckedGoals) / windowFrameCount,
+					confirmedGoalCount, goalCount, goalSubsystem->GetAwakeGoalCount());
+
+				// Nothing is confirmed early in the run. Confirmed goals rest on their ball bearing and are only checked every RestingCheckInterval
+				ensureMsgf(confirmedGoalCount == 0 || lastCheckedGoals < firstCheckedGoals,
+					TEXT("%d goals confirmed a ball bearing but checked goals per frame didn't drop (%d then %d over %d frames)"),
+					confirmedGoalCount, firstCheckedGoals, lastCheckedGoals, windowFrameCount);
+
+				StressUtilities::DestroySpawned(weakSpawnedActors);
+				return false;
+			}));
+	}));
+
+#endif
@@ -6,6 +6,8 @@
 #include "GameFramework/Pawn.h"
 #include "BallBearing.generated.h"
 
+class UBallBearingMovementSubsystem;
+
 /**
  * Main ball bearing class, derived from pawn but with no input and no camera.
  */
@@ -38,6 +40,26 @@ protected:
 	// Called when game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Stop being moved by the movement subsystem
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Moves us if we registered with it, we only forward input
+	UPROPERTY()
+	TObjectPtr<UBallBearingMovementSubsystem> MovementSubsystem = nullptr;
+
+	// Our index in the movement subsystem, kept up to date by it
+	int32 MovementIndex = INDEX_NONE;
+
+	bool IsMovementRegistered() const
+	{
+		return MovementSubsystem && MovementIndex != INDEX_NONE;
+	}
+
+	// Called by the movement subsystem when we dash
+	virtual void OnDashed() const
+	{
+	}
+
 private:
 	/**
 	 * @brief The initial location of the ball bearing at game start.
@@ -46,4 +68,7 @@ private:
 
 	// Allow the ball bearing HUD unfettered access to this class.
 	friend class ABallBearingHUD;
+
+	// Keeps MovementIndex and tells us about dashes
+	friend class UBallBearingMovementSubsystem;
 };
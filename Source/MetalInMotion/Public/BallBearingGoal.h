@@ -3,10 +3,13 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "BallBearingOverlapSet.h"
 #include "Engine/TriggerSphere.h"
 #include "BallBearingGoal.generated.h"
 
 class ABallBearing;
+class AMetalInMotionGameModeBase;
+class UBallBearingGoalSubsystem;
 class UParticleSystemComponent;
 
 /**
@@ -26,9 +29,6 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Magnetism")
 	float Magnetism = 7500.0f;
 
-private:
-	void HandleBallMagnetism();
-
 public:
 	// Overlapped ball bearing distance needs to be less than this to has ball bearing
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|HasBallBearing")
@@ -38,19 +38,50 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|HasBallBearing")
 	float LessThanVelSizeToHasBallBearing = 100.0f;
 
+	// A ball bearing has to meet the conditions above this many seconds before we have it
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|HasBallBearing")
 	float TimeToWaitForConfirmHasBallBearing = 1;
 
+	// Seconds between has ball bearing checks while a confirmed ball bearing rests in our center, magnetism is off in between
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|HasBallBearing")
+	float RestingCheckInterval = 0.25f;
+
+	// Does the level end need this goal to have a ball bearing ?
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|HasBallBearing")
+	bool bCountsForLevelEnd = true;
+
 private:
-	void CheckHasBallBearing();
+	// Gain or lose our ball bearing, the goal subsystem evaluates the conditions above for all our bearings at once
+	void UpdateHasBallBearing(bool bMeetsConditions, double now);
+
+	// Squares of the thresholds above so the goal subsystem compares without square roots
+	float MaxDistanceToHasBallBearingSquared = 0.0f;
+	float LessThanVelSizeToHasBallBearingSquared = 0.0f;
 
-	FTimerHandle ConfirmHasBallBearingTimerHandle;
+	void UpdateSquaredThresholds();
+
+	// World time the ball bearing started meeting conditions, valid while bPotentialHasBallBearing
+	double PotentialHasBallBearingStartTime = 0.0;
+
+	// The goal subsystem skips our magnetism and checks until this world time
+	double NextCheckTime = 0.0;
 
 	// is the given actor ball bearing and magnetized
 	ABallBearing* IsBallBearingAndMagnetized(AActor* OtherActor) const;
 
-	// If has ball bearing, activate blueish fire if not activate normal.
-	void HandleHasBallBearingVfX() const;
+	// Ask the goal subsystem to bring the fire vfx in line with has ball bearing, applied later by UpdateVfx
+	void HandleHasBallBearingVfX();
+
+	// If has ball bearing, activate blueish fire if not activate normal. False if the last change is too recent, try again later
+	bool UpdateVfx(double now);
+
+	// The has ball bearing state the fire vfx currently shows, valid if bVfxApplied
+	bool bVfxShowsHasBallBearing = false;
+
+	bool bVfxApplied = false;
+
+	// World time the fire vfx last switched
+	double LastVfxChangeTime = 0.0;
 
 public:
 	// Normal fire vfx, plays when goal doesnt have ball bearing
@@ -61,6 +92,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="BallBearing|FireVfx")
 	UParticleSystemComponent* HasBallBearingFireVfx = nullptr;
 
+	// Fire vfx stays at least this many seconds before switching again, so a jittering ball bearing doesn't flap it
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="BallBearing|FireVfx")
+	float MinVfxDwellTime = 0.25f;
+
 private:
 	// Do we currently have a ball bearing ?
 	bool bHasBallBearing = false;
@@ -68,6 +103,23 @@ private:
 	// This indicates that a ball bearing meets conditions and waiting some seconds to confirm
 	bool bPotentialHasBallBearing = false;
 
+	// The game mode we report our has ball bearing changes to
+	UPROPERTY()
+	TObjectPtr<AMetalInMotionGameModeBase> GameMode = nullptr;
+
+	// Tell the game mode we gained or lost our ball bearing
+	void NotifyGameModeHasBallBearingChanged() const;
+
+	// Applies our magnetism while we are awake
+	UPROPERTY()
+	TObjectPtr<UBallBearingGoalSubsystem> GoalSubsystem = nullptr;
+
+	// Get magnetism and checks from the goal subsystem only while ball bearings are in range
+	void SetAwake(bool bAwake);
+
+	// Check less often while our confirmed ball bearing still meets the conditions
+	void UpdateNextCheckTime(bool bMeetsConditions, double now);
+
 public:
 	// Does this goal have a ball bearing resting in its center?
 	bool HasBallBearing() const { return bHasBallBearing; };
@@ -76,12 +128,17 @@ protected:
 	// Add this ball bearing goal to game mode ball bearing goals
 	virtual void BeginPlay() override;
 
-	// Apply magnetism to nearby non player ball bearings and check goals for game end
-	virtual void Tick(float DeltaSeconds) override;
+	// Remove this ball bearing goal from the goal subsystem
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// Hide the collision and sprite components in-game.
 	virtual void PostInitializeComponents() override;
 
+#if WITH_EDITOR
+	// Keep the squared thresholds in sync with edited properties
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	// Add a ball bearing to the list of proximate bearings we're maintaining.
 	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
 
@@ -89,7 +146,15 @@ protected:
 	virtual void NotifyActorEndOverlap(AActor* OtherActor) override;
 
 private:
-	// A list of proximate ball bearings.
-	UPROPERTY()
-	TArray<ABallBearing*> BallBearings;
+	// A set of proximate ball bearings.
+	FBallBearingOverlapSet BallBearings;
+
+	// Drop destroyed and pooled ball bearings, true if that left us without ball bearings
+	bool PruneBallBearings();
+
+	// Settle our state and stop getting magnetism and checks
+	void GoToSleep();
+
+	// The goal subsystem applies our magnetism to BallBearings and checks them
+	friend class UBallBearingGoalSubsystem;
 };
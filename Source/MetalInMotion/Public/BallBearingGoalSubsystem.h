@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BallBearingMagnetismField.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BallBearingGoalSubsystem.generated.h"
+
+class ABallBearing;
+class ABallBearingGoal;
+class FBallBearingMagnetismSimCallback;
+class FPhysScene_Chaos;
+
+/**
+ * Runs the per frame work of every ball bearing goal in one batched pass.
+ * Goal magnetism is gathered into flat arrays, computed per goal and bearing pair and applied once per bearing.
+ * Then every goal checks if a ball bearing rests in its center from the same gathered locations and velocities.
+ * Goals resting on a confirmed ball bearing skip both until their next check.
+ * Both run right before the physics step, where goals used to do them in their pre physics tick.
+ */
+UCLASS()
+class METALINMOTION_API UBallBearingGoalSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Goals register themselves while ball bearings are in their range
+	void Register(ABallBearingGoal* ballBearingGoal);
+
+	// Goals unregister themselves when the last ball bearing leaves and in EndPlay
+	void Unregister(ABallBearingGoal* ballBearingGoal);
+
+	// Goals call this when their has ball bearing changes, their fire vfx is updated on a later frame
+	void RequestVfxUpdate(ABallBearingGoal* ballBearingGoal);
+
+	// Goals call this in EndPlay
+	void CancelVfxUpdate(ABallBearingGoal* ballBearingGoal);
+
+	// Goals call this when they begin or end play, the baked magnetism field is rebuilt before its next use
+	void MarkMagnetismFieldDirty()
+	{
+		bMagnetismFieldDirty = true;
+	}
+
+	// Update the fire vfx of goals that asked for it
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// Register the physics thread magnetism callback with the world's physics solver and hook the physics scene's pre tick
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// Unregister the physics thread magnetism callback
+	virtual void Deinitialize() override;
+
+	// Seconds the last magnetism pass took, for stress measurements
+	double GetLastMagnetismSeconds() const
+	{
+		return LastMagnetismSeconds;
+	}
+
+	// Seconds the last goal check pass took, for stress measurements
+	double GetLastGoalCheckSeconds() const
+	{
+		return LastGoalCheckSeconds;
+	}
+
+	// Goals the last goal check pass checked, resting goals are skipped
+	int32 GetLastCheckedGoalCount() const
+	{
+		return LastCheckedGoalCount;
+	}
+
+	// Awake goals, checked or resting
+	int32 GetAwakeGoalCount() const
+	{
+		return Goals.Num();
+	}
+
+protected:
+	// Goals only exist in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	// Every goal with ball bearings in range
+	UPROPERTY()
+	TArray<TObjectPtr<ABallBearingGoal>> Goals;
+
+	// Fill the flat arrays below from the goals and the ball bearings in their range
+	void GatherMagnetism();
+
+	// Called on the game thread after this frame's ticks before physics, apply magnetism of every goal to the ball bearings in their range and check goals for ball bearings
+	void OnPhysScenePreTick(FPhysScene_Chaos* physicsScene, float deltaSeconds);
+
+	FDelegateHandle PhysScenePreTickHandle;
+
+	// Calculate the force of every goal and bearing pair and sum them per bearing, on task graph workers if enabled
+	void ComputeMagnetismForces();
+
+	// Apply the summed forces with one AddForce per bearing, on the game thread
+	void ApplyMagnetismForces();
+
+	// Sample the baked field once per bearing instead of computing every goal and bearing pair
+	void SampleMagnetismField();
+
+	// Bake every goal in the world into MagnetismField, goals are expected to stay where they are placed
+	void BakeMagnetismField();
+
+	// Summed magnetism of every goal, used when MetalInMotion.MagnetismField is enabled
+	FBallBearingMagnetismField MagnetismField;
+
+	bool bMagnetismFieldDirty = true;
+
+	// Send the gathered goals and bearing physics proxies to the physics thread magnetism callback
+	void PushAsyncMagnetism();
+
+	// Applies magnetism on the physics thread when MetalInMotion.AsyncMagnetism is enabled, owned by the physics solver
+	FBallBearingMagnetismSimCallback* MagnetismSimCallback = nullptr;
+
+	// Did the physics thread get magnetism input last frame ?
+	bool bAsyncMagnetismActive = false;
+
+	// Group pair indices by bearing in pair order so every bearing sums its forces in the same order on any thread count
+	void BuildBearingPairLists();
+
+	// Drop destroyed and pooled ball bearings from the goals, putting emptied goals to sleep
+	void PruneGoals();
+
+	// Let every goal due for a check gain or lose its ball bearing
+	void CheckGoals();
+
+	// Index of the given bearing in the bearing arrays, adding it if first seen this frame
+	int32 FindOrAddBearing(const ABallBearing* ballBearing);
+
+	// Goals whose fire vfx doesn't show their has ball bearing yet, awake or not
+	UPROPERTY()
+	TArray<TObjectPtr<ABallBearingGoal>> PendingVfxGoals;
+
+	// Let every pending goal switch its fire vfx once, keeping the ones still in their dwell time
+	void UpdateGoalVfx();
+
+	// Per goal data
+	TArray<FVector> GoalLocations;
+	TArray<float> GoalRadii;
+	TArray<float> GoalMagnetisms;
+
+	// Pairs of goal i are PairGoalIndices[GoalPairOffsets[i]] to PairGoalIndices[GoalPairOffsets[i + 1] - 1], goal i is Goals[i]
+	TArray<int32> GoalPairOffsets;
+
+	// Per bearing data, every bearing appears once no matter how many goals it is in range of
+	TArray<const ABallBearing*> Bearings;
+	TArray<FVector> BearingLocations;
+	TArray<float> BearingSpeedsSquared;
+	TArray<FVector> BearingForces;
+	TMap<const ABallBearing*, int32> BearingIndices;
+
+	// Per goal and bearing pair data
+	TArray<int32> PairGoalIndices;
+	TArray<int32> PairBearingIndices;
+	TArray<FVector> PairForces;
+
+	// Pair indices grouped by bearing, pairs of bearing i are BearingPairs[BearingPairOffsets[i]] to BearingPairs[BearingPairOffsets[i + 1] - 1]
+	TArray<int32> BearingPairOffsets;
+	TArray<int32> BearingPairs;
+
+	double LastMagnetismSeconds = 0.0;
+
+	double LastGoalCheckSeconds = 0.0;
+
+	int32 LastCheckedGoalCount = 0;
+
+	// MetalInMotion.ExtraMagnetism, looked up once
+	IConsoleVariable* ExtraMagnetismCVar = nullptr;
+};
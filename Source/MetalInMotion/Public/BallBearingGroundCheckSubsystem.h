@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BallBearingGroundCheckSubsystem.generated.h"
+
+/**
+ * Batches the ground sweeps of ball bearings into async scene queries.
+ * Bearings request a sweep whenever they need one and read the result of an earlier sweep,
+ * all requests are issued together once per frame and their results arrive on the next frame.
+ */
+UCLASS()
+class METALINMOTION_API UBallBearingGroundCheckSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Ask for a sweep, issued with the others on this frame's tick if the bearing's turn came by MetalInMotion.AsyncGroundCheckInterval
+	void RequestSweep(const AActor* bearing, const FVector& start, const FVector& end, float radius, ECollisionChannel traceChannel);
+
+	// Result of the bearing's last finished sweep, nullptr if none finished recently enough to use
+	const FHitResult* FindLatestHit(const AActor* bearing) const;
+
+	// The movement subsystem unregisters bearings when they stop moving with it
+	void Unregister(const AActor* bearing);
+
+	// Issue requested sweeps
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// Should bearings use this instead of sweeping themselves ?
+	static bool IsEnabled();
+
+protected:
+	// Bearings only exist in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	struct FGroundSweep
+	{
+		FVector Start = FVector::ZeroVector;
+		FVector End = FVector::ZeroVector;
+		float Radius = 0.0f;
+		ECollisionChannel TraceChannel = ECC_Visibility;
+
+		// Requested since the last issued sweep
+		bool bRequested = false;
+
+		// Spreads bearings over the frames of the interval
+		uint32 Stagger = 0;
+
+		// GFrameCounter the last sweep was issued in, and the one whose result is in Hit
+		uint64 IssuedFrame = 0;
+		uint64 HitFrame = 0;
+
+		bool bHasHit = false;
+		FHitResult Hit;
+	};
+
+	// Store the result of a finished sweep
+	void OnSweepDone(const FTraceHandle& traceHandle, FTraceDatum& traceDatum, TWeakObjectPtr<const AActor> bearing);
+
+	TMap<TWeakObjectPtr<const AActor>, FGroundSweep> Sweeps;
+
+	uint32 NextStagger = 0;
+};
@@ -6,6 +6,8 @@
 #include "DebugHUD.h"
 #include "BallBearingHUD.generated.h"
 
+class APooler;
+
 /**
  * 
  */
@@ -17,4 +19,22 @@ class ABallBearingHUD : public ADebugHUD
 protected:
 	// Draw the HUD
 	virtual void DrawHUD() override;
+
+private:
+	// Draw capacity, usage and churn of every registered pooler, enabled by MetalInMotion.ShowPoolStats
+	void DrawPoolStats();
+
+	// Acquire and release counts of a pooler at the start of the current rate window and the rates of the last window
+	struct FPoolRateSample
+	{
+		int64 AcquireCount = 0;
+		int64 ReleaseCount = 0;
+		float AcquiresPerSecond = 0.0f;
+		float ReleasesPerSecond = 0.0f;
+	};
+
+	TMap<TWeakObjectPtr<const APooler>, FPoolRateSample> PoolRateSamples;
+
+	// Real time the current rate window started at
+	double PoolRateWindowStart = 0.0;
 };
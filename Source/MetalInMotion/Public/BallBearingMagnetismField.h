@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Goal magnetism baked into a sparse grid of force samples, for levels whose goals don't move.
+ * Samples are stored in bricks of BrickSize^3 grid corners that only exist around goals,
+ * so a ball bearing gets the summed force of every goal with one trilinear lookup.
+ */
+class METALINMOTION_API FBallBearingMagnetismField
+{
+public:
+	// Drop every sample and use the given distance between grid corners from now on
+	void Reset(float cellSize);
+
+	// Add the pull of a goal to the corners inside its radius, full magnetism at the center and none at the edge
+	void AddGoal(const FVector& location, float radius, float magnetism);
+
+	// Summed goal force at the given location, interpolated from the eight surrounding corners
+	FVector Sample(const FVector& location) const;
+
+	float GetCellSize() const
+	{
+		return CellSize;
+	}
+
+	bool IsEmpty() const
+	{
+		return BrickIndices.IsEmpty();
+	}
+
+private:
+	// Bricks are 2^BrickBits corners along every axis
+	static constexpr int32 BrickBits = 3;
+	static constexpr int32 BrickSize = 1 << BrickBits;
+	static constexpr int32 BrickMask = BrickSize - 1;
+	static constexpr int32 BrickSampleCount = BrickSize * BrickSize * BrickSize;
+
+	// Sample at the given grid corner, zero where no brick exists
+	FVector3f GetCorner(const FIntVector& corner) const;
+
+	// Writable sample at the given grid corner, adding its brick if needed
+	FVector3f& FindOrAddCorner(const FIntVector& corner);
+
+	static int32 GetSampleIndex(const FIntVector& corner)
+	{
+		return ((corner.Z & BrickMask) * BrickSize + (corner.Y & BrickMask)) * BrickSize + (corner.X & BrickMask);
+	}
+
+	// Arithmetic shift floors negative corners into the right brick too
+	static FIntVector GetBrickCoordinate(const FIntVector& corner)
+	{
+		return FIntVector(corner.X >> BrickBits, corner.Y >> BrickBits, corner.Z >> BrickBits);
+	}
+
+	// Start of every brick in Samples by brick coordinate
+	TMap<FIntVector, int32> BrickIndices;
+
+	// BrickSampleCount samples per brick, X fastest
+	TArray<FVector3f> Samples;
+
+	float CellSize = 25.0f;
+};
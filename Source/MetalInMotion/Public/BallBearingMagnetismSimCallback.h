@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+
+class FSingleParticlePhysicsProxy;
+
+// Goals and the ball bearings in their range, sent from the game thread once per frame
+struct FBallBearingMagnetismAsyncInput : public Chaos::FSimCallbackInput
+{
+	TArray<FVector> GoalLocations;
+	TArray<float> GoalRadii;
+	TArray<float> GoalMagnetisms;
+
+	// Per goal and bearing pair data
+	TArray<int32> PairGoalIndices;
+	TArray<FSingleParticlePhysicsProxy*> PairBearingProxies;
+
+	void Reset()
+	{
+		GoalLocations.Reset();
+		GoalRadii.Reset();
+		GoalMagnetisms.Reset();
+		PairGoalIndices.Reset();
+		PairBearingProxies.Reset();
+	}
+};
+
+struct FBallBearingMagnetismAsyncOutput : public Chaos::FSimCallbackOutput
+{
+	void Reset()
+	{
+	}
+};
+
+/**
+ * Applies goal magnetism on the physics thread before physics steps that get input from the game thread, using the physics thread positions of the ball bearings.
+ * Input isn't kept for later steps, the bearing proxies it points to may be destroyed by then.
+ */
+class FBallBearingMagnetismSimCallback : public Chaos::TSimCallbackObject<FBallBearingMagnetismAsyncInput, FBallBearingMagnetismAsyncOutput>
+{
+private:
+	virtual void OnPreSimulate_Internal() override;
+};
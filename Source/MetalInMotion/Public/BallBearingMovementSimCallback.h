@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/SimCallbackInput.h"
+#include "Chaos/SimCallbackObject.h"
+
+class FSingleParticlePhysicsProxy;
+
+// Movement input and handling of a single ball bearing
+struct FBallBearingMovementInput
+{
+	FSingleParticlePhysicsProxy* Proxy = nullptr;
+
+	// Never reused, unlike proxy addresses, so state kept between steps can't pass to another bearing
+	uint32 BearingId = 0;
+
+	// Move input of the frame, applied only if bHasMoveInput
+	FVector InputVector = FVector::ZeroVector;
+	bool bHasMoveInput = false;
+
+	// Acceleration towards input, cm/s^2
+	float ControllerForce = 0.0f;
+
+	// Horizontal speed is damped back to this, cm/s, while bClampSpeed
+	float MaximumSpeed = 0.0f;
+	float ClampToMaxSpeedInterpSpeed = 0.0f;
+	bool bClampSpeed = false;
+
+	// Angular velocity towards input in degrees per second and how fast we get there, while bInAir
+	float InAirAngularVelocity = 0.0f;
+	float InAirToAngularVelocitySpeed = 0.0f;
+	bool bInAir = false;
+};
+
+// Every moving ball bearing, sent from the game thread once per frame
+struct FBallBearingMovementAsyncInput : public Chaos::FSimCallbackInput
+{
+	TArray<FBallBearingMovementInput> Bearings;
+
+	void Reset()
+	{
+		Bearings.Reset();
+	}
+};
+
+struct FBallBearingMovementAsyncOutput : public Chaos::FSimCallbackOutput
+{
+	void Reset()
+	{
+	}
+};
+
+/**
+ * Moves ball bearings on the physics thread before physics steps that get input from the game thread: input force, in air steering and the speed clamp.
+ * Input isn't kept for later steps, the bearing proxies it points to may be destroyed by then.
+ */
+class FBallBearingMovementSimCallback : public Chaos::TSimCallbackObject<FBallBearingMovementAsyncInput, FBallBearingMovementAsyncOutput>
+{
+private:
+	virtual void OnPreSimulate_Internal() override;
+
+	// Critically damped spring state of every bearing's speed clamp by bearing id, kept between steps
+	TMap<uint32, FVector> ClampSpringVelocities;
+};
@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicsInterfaceDeclaresCore.h"
+#include "PlayerBallBearing.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BallBearingMovementSubsystem.generated.h"
+
+class FBallBearingMovementSimCallback;
+class FPhysScene_Chaos;
+class UBallBearingGroundCheckSubsystem;
+
+// Handling of a ball bearing, copied from its tuning when it registers
+struct FBallBearingMovementParams
+{
+	// Acceleration towards input, cm/s^2
+	float ControllerForce = 0.0f;
+
+	// Horizontal speed is damped back to this, cm/s, while not dashing
+	float MaximumSpeed = 0.0f;
+	float ClampToMaxSpeedInterpSpeed = 0.0f;
+
+	// Upwards impulse of a jump
+	float JumpImpulse = 0.0f;
+
+	// Angular velocity towards input in degrees per second and how fast we get there, while in air
+	float InAirAngularVelocity = 0.0f;
+	float InAirToAngularVelocitySpeed = 0.0f;
+
+	// Linear and angular impulse of a dash
+	float DashImpulse = 0.0f;
+	float DashAngularImpulse = 0.0f;
+
+	// Seconds a dash lasts and seconds from a dash until the next one is allowed
+	float DashTime = 0.0f;
+	float DashCoolDown = 0.0f;
+
+	// Seconds a jump or dash press waits for the bearing to be able to do it
+	float JumpBufferTime = 0.0f;
+	float DashBufferTime = 0.0f;
+
+	// Seconds after leaving the ground a jump is still allowed
+	float CoyoteTime = 0.0f;
+
+	// Ground sweep down from the bearing's center, distance and radius in cm
+	float GroundTraceDistance = 0.0f;
+	float GroundTraceRadius = 0.0f;
+	ECollisionChannel GroundTraceChannel = ECC_Visibility;
+
+	// Least normal Z of a hit that counts as ground contact
+	float MinGroundNormalZ = 1.0f;
+};
+
+/**
+ * Moves every registered ball bearing in one batched pass right before physics starts for a frame.
+ * Per bearing state lives in contiguous arrays indexed by the bearing's movement index, bearings only forward their input and hits.
+ * Grounding is kept here from hit contacts and ground sweeps, physics state is read once per bearing,
+ * the handling math runs on task graph workers if enabled and physics writes are applied together.
+ * With MetalInMotion.AsyncMovement enabled the handling math runs on the physics thread every physics step instead.
+ */
+UCLASS()
+class METALINMOTION_API UBallBearingMovementSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// Ball bearings register themselves in BeginPlay with their handling, returns their movement index
+	int32 Register(ABallBearing* ballBearing, const FBallBearingMovementParams& movementParams);
+
+	// Ball bearings unregister themselves in EndPlay. The last bearing takes the index
+	void Unregister(int32 movementIndex);
+
+	// Ball bearings forward their hits, ones with a ground normal keep the bearing grounded until contacts stop
+	void NotifyHit(int32 movementIndex, const FVector& hitNormal);
+
+	// Move towards the given input this frame
+	void SetMoveInput(int32 movementIndex, const FVector& inputVector);
+
+	// Jump on the first update within JumpBufferTime that we are grounded or left the ground less than CoyoteTime ago
+	void RequestJump(int32 movementIndex);
+
+	// Dash on the first update within DashBufferTime that the dash cooldown is over
+	void RequestDash(int32 movementIndex);
+
+	// Dash towards input, or the way we move if none, true if dashed. Dashing ends on the first update after DashTime
+	bool Dash(int32 movementIndex);
+
+	// Change state unless dashing
+	void SetState(int32 movementIndex, EPlayerBallBearingState state)
+	{
+		if (States[movementIndex] == Dashing)return;
+
+		States[movementIndex] = state;
+	}
+
+	EPlayerBallBearingState GetState(int32 movementIndex) const
+	{
+		return States[movementIndex];
+	}
+
+	// Last move input, kept after input stops
+	const FVector& GetInputVector(int32 movementIndex) const
+	{
+		return InputVectors[movementIndex];
+	}
+
+	bool GetCanDash(int32 movementIndex) const
+	{
+		return GetWorld()->GetTimeSeconds() >= DashReadyTimes[movementIndex];
+	}
+
+	// Grounded as of the last movement pass or ground contact
+	bool IsGrounded(int32 movementIndex) const
+	{
+		return GroundedFlags[movementIndex] != 0;
+	}
+
+	// World time the bearing was last grounded
+	double GetLastGroundedTime(int32 movementIndex) const
+	{
+		return LastGroundedTimes[movementIndex];
+	}
+
+	// Seconds the last movement pass took, for stress measurements
+	double GetLastMovementSeconds() const
+	{
+		return LastMovementSeconds;
+	}
+
+	// Should player ball bearings leave their force, steering and speed clamp to the physics thread ?
+	bool IsAsyncMovementActive() const;
+
+	// Register the physics thread movement callback, hook the physics scene's pre tick and find the ground check subsystem
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+
+	// Unregister the physics thread movement callback
+	virtual void Deinitialize() override;
+
+protected:
+	// Bearings only exist in game worlds
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	// Called on the game thread after this frame's input and ticks before physics, move every bearing
+	void OnPhysScenePreTick(FPhysScene_Chaos* physicsScene, float deltaSeconds);
+
+	// Update grounding and read physics state of every bearing, end dashes whose time is up and leave dash free states by ground
+	void GatherBearings();
+
+	// Sweep down for ground, with an async sweep of an earlier frame if MetalInMotion.AsyncGroundCheck is on
+	void TraceGround(int32 movementIndex, double now);
+
+	// Grounded if a ground sweep hit an actor
+	void ApplyGroundHit(int32 movementIndex, const FHitResult& hit, double now);
+
+	// Dash and decide jumps for the buffered presses that can be done now, dropping the ones that waited too long
+	void ConsumeBufferedInput();
+
+	// Calculate force, steering, speed clamp and jumps of every bearing, on task graph workers if enabled
+	void ComputeMovement(float deltaSeconds);
+
+	// Apply the results of ComputeMovement, on the game thread
+	void ApplyMovement();
+
+	// Send every bearing's input and handling to the physics thread, jumps are still applied here
+	void PushAsyncMovement();
+
+	// Physics writes of a bearing this frame, bits of EMovementWrite
+	enum EMovementWrite : uint8
+	{
+		WriteVelocity = 1 << 0,
+		WriteAngularVelocity = 1 << 1,
+		WriteJumpImpulse = 1 << 2
+	};
+
+	// Per bearing state
+	UPROPERTY()
+	TArray<TObjectPtr<ABallBearing>> Owners;
+	TArray<uint32> BearingIds;
+	TArray<UPrimitiveComponent*> Bodies;
+
+	// Physics proxies of the bodies, read with the physics state every frame since bodies can recreate them
+	TArray<FPhysicsActorHandle> Proxies;
+	TArray<FBallBearingMovementParams> Params;
+	TArray<FVector> InputVectors;
+	TArray<EPlayerBallBearingState> States;
+	TArray<FVector> ClampSpringVelocities;
+
+	// World times the running dash ends and the next dash is allowed, no timers involved
+	TArray<double> DashEndTimes;
+	TArray<double> DashReadyTimes;
+
+	// Per bearing input of this frame, cleared after every update
+	TArray<uint8> HasMoveInput;
+
+	// World times of buffered jump and dash presses, negative if none waiting
+	TArray<double> JumpPressTimes;
+	TArray<double> DashPressTimes;
+
+	// World time of the last jump, a jump uses up the coyote time of the ground it left
+	TArray<double> LastJumpTimes;
+
+	// Grounding, kept across frames. Contacts are ground hits since the last movement pass
+	TArray<uint8> GroundedFlags;
+	TArray<double> LastGroundedTimes;
+	TArray<uint8> GroundContacts;
+
+	// Per bearing jumps decided this frame
+	TArray<uint8> Jumps;
+
+	// Per bearing physics state read this frame
+	TArray<FVector> Velocities;
+	TArray<FVector> AngularVelocitiesInDeg;
+	TArray<float> Masses;
+
+	// Per bearing physics writes of this frame
+	TArray<FVector> Forces;
+	TArray<FVector> NewVelocities;
+	TArray<FVector> NewAngularVelocitiesInDeg;
+	TArray<uint8> Writes;
+
+	// Id of the next registered bearing, ids aren't reused so the physics thread can keep state by them
+	uint32 NextBearingId = 0;
+
+	// Owned by the physics solver
+	FBallBearingMovementSimCallback* MovementSimCallback = nullptr;
+
+	// Batches ground sweeps when MetalInMotion.AsyncGroundCheck is on
+	UPROPERTY()
+	TObjectPtr<UBallBearingGroundCheckSubsystem> GroundCheckSubsystem = nullptr;
+
+	FDelegateHandle PhysScenePreTickHandle;
+
+	// Did the physics thread get movement input last frame ?
+	bool bAsyncMovementActive = false;
+
+	double LastMovementSeconds = 0.0;
+};
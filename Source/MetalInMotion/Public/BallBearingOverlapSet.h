@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ABallBearing;
+
+/**
+ * The ball bearings overlapping a goal, in an inline allocated array with O(1) add and swap remove.
+ * Holds weak handles so destroyed ball bearings never dangle, Prune drops them and pooled ones.
+ */
+class METALINMOTION_API FBallBearingOverlapSet
+{
+public:
+	// Add the ball bearing if not in already, true if added
+	bool Add(ABallBearing* ballBearing);
+
+	// Remove the ball bearing if in, true if removed. Order of the others may change
+	bool Remove(ABallBearing* ballBearing);
+
+	// Drop destroyed ball bearings and the ones returned to a pool, true if any dropped
+	bool Prune();
+
+	int32 Num() const
+	{
+		return Items.Num();
+	}
+
+	bool IsEmpty() const
+	{
+		return Items.IsEmpty();
+	}
+
+	// Ball bearing at given index, nullptr if destroyed since the last Prune
+	ABallBearing* operator[](int32 index) const
+	{
+		return Items[index].Get();
+	}
+
+private:
+	// Most goals hold a few ball bearings at most, those never allocate
+	static constexpr int32 InlineCount = 8;
+
+	void RemoveAtSwap(int32 index);
+
+	TArray<TWeakObjectPtr<ABallBearing>, TInlineAllocator<InlineCount>> Items;
+
+	// Index of every ball bearing in Items
+	TMap<TWeakObjectPtr<ABallBearing>, int32, TInlineSetAllocator<InlineCount>> Indices;
+};
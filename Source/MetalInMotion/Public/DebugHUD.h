@@ -26,10 +26,11 @@ protected:
 	 * @brief Add a FText to the HUD for rendering.
 	 * @param title 
 	 * @param value 
+	 * @param valueColor 
 	 */
-	void AddText(const TCHAR* title, const FText& value)
+	void AddText(const TCHAR* title, const FText& value, const FLinearColor& valueColor = FLinearColor::White)
 	{
-		RenderStatistic(title, value);
+		RenderStatistic(title, value, valueColor);
 	}
 
 	void AddFloat(const TCHAR* title, float value)
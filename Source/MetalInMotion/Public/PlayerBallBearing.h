@@ -8,6 +8,7 @@
 #include "PlayerBallBearing.generated.h"
 
 struct FInputActionValue;
+struct FBallBearingMovementParams;
 
 UENUM()
 enum EPlayerBallBearingState
@@ -53,7 +54,7 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|In Air")
 	float InAirToAngularVelocitySpeed = 2.25f;
 
-	// How much force to use to have the ball bearing dash
+	// Seconds a dash lasts, speed isn't clamped meanwhile
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Dash")
 	float DashTime = 0.1f;
 
@@ -65,10 +66,22 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Dash")
 	float DashAngularImpulsePower = 10000000.0f;
 
-	// Timer used to control the dashing of the ball bearing
+	// Seconds after a dash until the ball bearing can dash again
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Dash")
 	float DashCoolDown = 0.0f;
 
+	// Seconds a jump press waits for the ball bearing to land
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Input Buffer")
+	float JumpBufferTime = 0.15f;
+
+	// Seconds after leaving the ground the ball bearing can still jump
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Input Buffer")
+	float CoyoteTime = 0.1f;
+
+	// Seconds a dash press waits for the dash cooldown
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="BallBearing|Input Buffer")
+	float DashBufferTime = 0.15f;
+
 	// The vfx component that plays when dashed
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="BallBearing|Dash")
 	UParticleSystemComponent* DashVfxComponent = nullptr;
@@ -82,6 +95,9 @@ public:
 	// Move the ball bearing with the incoming input value
 	void Move(const FInputActionValue& InputActionValue);
 
+	// Our tuning in the units the movement subsystem works with
+	FBallBearingMovementParams GetMovementParams() const;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Sphere Trace For Grounded")
 	TEnumAsByte<ETraceTypeQuery> SphereTraceTypeQuery;
 
@@ -93,65 +109,42 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Sphere Trace For Grounded")
 	float SphereTraceRadiusMultiplier = 0.5f;
 
+	// A hit counts as ground contact if its normal's Z is at least this, used by MetalInMotion.ContactGroundDetection
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Sphere Trace For Grounded")
+	float MinGroundNormalZ = 0.7f;
+
 protected:
-	// Control the movement of the ball bearing, called every frame.
-	virtual void Tick(float deltaSeconds) override;
+	// Register with the movement subsystem
+	virtual void BeginPlay() override;
 
-	// Change ball bearing state when grounded
-	virtual void NotifyHit(UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override
-	{
-		Super::NotifyHit(MyComp, Other, OtherComp, bSelfMoved, HitLocation, HitNormal, NormalImpulse, Hit);
+	// Report ground contacts to the movement subsystem and change ball bearing state when grounded
+	virtual void NotifyHit(UPrimitiveComponent* MyComp, AActor* Other, UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 
-		if (IsGrounded())ChangeBallBearingState(Grounded);
-	}
+	// Play the dash vfx
+	virtual void OnDashed() const override;
 
 private:
-	// Player ball bearing state
-	EPlayerBallBearingState CurrentPlayerBallBearingState = InAir;
-
-	// Change player ball bearing state if not dashing.
-	void ChangeBallBearingState(const EPlayerBallBearingState WantedPlayerBallBearingState, const bool overrideDashing = false)
-	{
-		if (CurrentPlayerBallBearingState == Dashing && !overrideDashing)return;
-
-		CurrentPlayerBallBearingState = WantedPlayerBallBearingState;
-	}
+	// Player ball bearing state, from the movement subsystem
+	EPlayerBallBearingState GetPlayerBallBearingState() const;
 
 	// the input vector. changed when a input has been registered
-	FVector InputVector = FVector::ZeroVector;
+	FVector GetInputVector() const;
+
+	// Player can dash if true
+	bool CanDash() const;
 
 	float GetMaximumSpeed() const
 	{
 		return MaximumSpeed * 100.0f;
 	}
 
-	// Player can dash if true
-	bool bCanDash = true;
-
-	// dash duration timer and dash cooldown timer
-	FTimerHandle DashTimer, DashCooldownTimer;
-
-	// for critically damped interpolation
-	FVector DashVelocity = FVector::ZeroVector;
-	FVector* DashVelocityPtr = &DashVelocity;
 
-	// Get ball mesh velocity without upwards axis
-	FVector GetVelocityWithoutZ(bool normalize = false) const
-	{
-		auto velocity = BallMesh->GetComponentVelocity();
-		velocity.Z = 0;
-
-		if (normalize)
-		{
-			velocity.Normalize();
-		}
-
-		return velocity;
-	}
-
-	// Check if the ball bearing is grounded
+	// Check if the ball bearing is grounded, from the movement subsystem's ground check of this frame
 	bool IsGrounded() const;
 
+	// Seconds since we were last grounded, zero while grounded
+	float GetTimeSinceGrounded() const;
+
 	// Just for HUD purposes
 	friend class ABallBearingHUD;
 };
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ABallBearing;
+class ABallBearingGoal;
+class APlayerBallBearing;
+
+/**
+ *  Spawns gameplay actors in bulk for measuring their cost
+ */
+namespace StressUtilities
+{
+	// Spawn goalCount goals on a grid high above the level, each with about bearingCount / goalCount gravity free ball bearings in its range.
+	// Spawned goals don't count for level end. Every spawned actor is added to outSpawnedActors
+	void SpawnGoalField(UWorld* world, int32 goalCount, int32 bearingCount, TArray<AActor*>& outSpawnedActors);
+
+	// Spawn bearingCount player ball bearings on a floor away from the goal field, moved by the movement subsystem without a controller.
+	// The floor and every bearing are added to outSpawnedActors, the bearings also to outBearings
+	void SpawnMovingBearings(UWorld* world, int32 bearingCount, TArray<AActor*>& outSpawnedActors, TArray<APlayerBallBearing*>& outBearings);
+
+	// Spawn poolerCount actor poolers of poolSize static mesh actors each, away from the goal field. Every spawned pooler is added to outSpawnedActors
+	void SpawnPoolers(UWorld* world, int32 poolerCount, int32 poolSize, TArray<AActor*>& outSpawnedActors);
+
+	// Destroy actors spawned by the functions above
+	void DestroySpawned(const TArray<TWeakObjectPtr<AActor>>& spawnedActors);
+}